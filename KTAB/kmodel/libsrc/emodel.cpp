@@ -498,6 +498,11 @@ EState<PT>* EState<PT>::doSUSN(ReportingLevel rl) const {
 
     ghc->nghbrs = nfn;
 
+    // every iteration offers the same enumerated options, so remember them
+    KBase::EvalCache evalMemo;
+    ghc->hash = [](const EPosition<PT> eph) { return (uint64_t)eph.getIndex(); };
+    ghc->cache = &evalMemo;
+
     // show some representation of this position on cout
     ghc->show = [](const EPosition<PT> & ep) {
       LOG(INFO) << ep ;
@@ -771,11 +776,9 @@ EState<PT>* EState<PT>::doMCN(ReportingLevel rl) const {
   const auto w = eMod->actorWeights(); // a row vector
   const unsigned int numNghbrs = neighbors.size();
 
-  // these two variables collect the results of a parallel search
-  // for the neighbor with highest Zeta
-  double bestZeta = 0.0; // all real zetas are positive
-  unsigned int bestNghbr = 0;
-  std::mutex nsEvalMutex;
+  // each neighbor's Zeta goes into its own slot, and the best is then
+  // picked in neighbor order, so the choice does not depend on threading
+  auto zetas = vector<double>(numNghbrs, 0.0);
 
   // somewhat more explicit than "auto"
   function < EState<PT>* (const VUI& , bool)>
@@ -801,7 +804,7 @@ EState<PT>* EState<PT>::doMCN(ReportingLevel rl) const {
 
 
   function<void(unsigned int)> testNghbr =
-      [&neighbors, &w, &nsEvalMutex, &bestZeta, &bestNghbr, rl, numA, numP, this, stateFromVUI]
+      [&neighbors, &w, &zetas, numA, numP, this, stateFromVUI]
       (unsigned int i) {
     const auto rlNewEU = ReportingLevel::Silent;
     const VUI ni = neighbors[i];
@@ -816,30 +819,7 @@ EState<PT>* EState<PT>::doMCN(ReportingLevel rl) const {
       throw KException("EState<PT>::doMCN: uMati matrix has wrong number of columns");
     }
     auto eui = ns->expUtilMat(rlNewEU, numA, numP, eMod->vpm, uMati); // col-vec
-    double zi = dot(trans(w), eui);
-
-    // fast, critical section
-    nsEvalMutex.lock();
-    if (0.0 > bestZeta) {
-      throw KException("EState<PT>::doMCN: bestZeta must be non-negative");
-    }
-    if (0.0 >= zi) {
-      throw KException("EState<PT>::doMCN: zi must be positive");
-    }
-    double delta = (zi - bestZeta)/(zi + bestZeta);
-    // Empirically, delta seems to be either at least E-4, or at most 1E-13.
-    // So I put the cut-off two orders below "significant".
-    const double sigDelta = 1E-6;
-    if ((bestZeta < zi) && (delta > sigDelta)) {
-      bestZeta = zi;
-      bestNghbr = i;
-      if (ReportingLevel::Low < rl) {
-        LOG(INFO) << KBase::getFormattedString("New best neighbor is %u with z=%.4f (delta=%.2E)\n",
-               i, zi, delta);
-        KBase::printVUI(ni);
-      }
-    }
-    nsEvalMutex.unlock();
+    zetas[i] = dot(trans(w), eui);
     delete ns;
     ns = nullptr;
     return;
@@ -868,6 +848,28 @@ EState<PT>* EState<PT>::doMCN(ReportingLevel rl) const {
     }
   }
 
+  double bestZeta = 0.0; // all real zetas are positive
+  unsigned int bestNghbr = 0;
+  for (unsigned int i=0; i<numNghbrs; i++) {
+    const double zi = zetas[i];
+    if (0.0 >= zi) {
+      throw KException("EState<PT>::doMCN: zi must be positive");
+    }
+    double delta = (zi - bestZeta)/(zi + bestZeta);
+    // Empirically, delta seems to be either at least E-4, or at most 1E-13.
+    // So I put the cut-off two orders below "significant".
+    const double sigDelta = 1E-6;
+    if ((bestZeta < zi) && (delta > sigDelta)) {
+      bestZeta = zi;
+      bestNghbr = i;
+      if (ReportingLevel::Low < rl) {
+        LOG(INFO) << KBase::getFormattedString("New best neighbor is %u with z=%.4f (delta=%.2E)\n",
+               i, zi, delta);
+        KBase::printVUI(neighbors[i]);
+      }
+    }
+  }
+
   VUI nghbr = neighbors[bestNghbr];
   if (ReportingLevel::Silent < rl) {
     LOG(INFO) << KBase::getFormattedString("Highest zeta is %.5f for state %u: \n", bestZeta, bestNghbr);
@@ -25,6 +25,8 @@
 #include <easylogging++.h>
 
 #include <time.h>
+#include <cmath>
+#include <limits>
 #include "kmodel.h"
 
 namespace KBase {
@@ -37,7 +39,7 @@ using KBase::nameFromEnum;
 // --------------------------------------------
 // Global Variables
 
-static std::mutex mtx_spce_log; // control access to log inside Model::scalarPCE
+static std::mutex mtx_spce_log; // keeps each Model::scalarPCE report contiguous in the log
 
 // --------------------------------------------
 string Model::lastExceptionMsg = string();
@@ -183,12 +185,23 @@ Model::~Model() {
 
 
 void Model::run() {
-  if (1 != history.size()) {
+  // a resumed model continues from the last state in its checkpoint
+  if ((!resumedP) && (1 != history.size())) {
     throw KException("Model::run: History size should not be more than 1 at this stage.");
   }
-  State* s0 = history[0];
+  if ((0 < histWindow) && (histWindow < 2)) {
+    // stopping rules compare the last two states, so both must be retained
+    throw KException("Model::run: histWindow must be zero or at least 2");
+  }
+  if ((0 < ckptEvery) && (0 == ckptFile.length())) {
+    throw KException("Model::run: ckptFile must be given when ckptEvery is non-zero");
+  }
+  if (!resumedP) {
+    histFlushed = 0;
+  }
+  unsigned int iter = ((unsigned int)(history.size())) - 1;
+  State* s0 = history[iter];
   bool done = false;
-  unsigned int iter = 0;
 
   while (!done) {
     if (nullptr == s0) {
@@ -198,12 +211,74 @@ void Model::run() {
       throw KException("Model::run: s0->step is a null pointer");
     }
     iter++;
+    KMetrics::setTurn(iter);
     LOG(INFO) << "Starting Model::run iteration" << iter;
-    auto s1 = s0->step();
+    State* s1 = nullptr;
+    {
+      KPhaseTimer tm("step");
+      s1 = s0->step();
+    }
     addState(s1);
-    done = stop(iter, s1);
+    {
+      KPhaseTimer tm("stop");
+      done = stop(iter, s1);
+    }
+    releaseHistory(false);
+    if ((!done) && (0 < ckptEvery) && (0 == (iter % ckptEvery))) {
+      // the checkpoint holds only turns 0, 1, and iter, so every turn
+      // before iter must be flushed now, or it could never be recorded
+      if (0 < histWindow) {
+        flushHistory(iter);
+      }
+      KPhaseTimer tm("checkpoint");
+      saveCheckpoint(ckptFile);
+    }
     s0 = s1;
   }
+  releaseHistory(true);
+  resumedP = false;
+  return;
+}
+
+void Model::resume(const string & fName) {
+  loadCheckpoint(fName);
+  run();
+  return;
+}
+
+void Model::releaseHistory(bool finalP) {
+  if (0 == histWindow) {
+    return;
+  }
+  const unsigned int hLen = ((unsigned int)(history.size()));
+  unsigned int tEnd = hLen;
+  if (!finalP) {
+    tEnd = (hLen > histWindow) ? (hLen - histWindow) : 0;
+  }
+  flushHistory(tEnd);
+
+  // the final flush keeps every remaining state, so post-run reports can still use them
+  if (!finalP) {
+    for (unsigned int t = histKeepFirst; t < tEnd; t++) {
+      delete history[t];
+      history[t] = nullptr;
+    }
+  }
+  return;
+}
+
+void Model::flushHistory(unsigned int tEnd) {
+  for (unsigned int t = histFlushed; t < tEnd; t++) {
+    State* st = history[t];
+    if (nullptr == st) {
+      continue; // not restored when resuming from a checkpoint
+    }
+    if (nullptr != flushState) {
+      KPhaseTimer tm("flushState");
+      flushState(t, st);
+    }
+  }
+  histFlushed = (tEnd > histFlushed) ? tEnd : histFlushed;
   return;
 }
 
@@ -414,6 +489,69 @@ double Model::vote(VotingRule vr, double wi, double uij, double uik) {
   return v;
 }
 
+// Per-rule copies of the response in Model::vote, so that each coalition
+// kernel computes only the curve its rule needs. Keep these in step with vote.
+template<VotingRule VR> inline double ruleVote(double wi, double du);
+
+template<> inline double ruleVote<VotingRule::Binary>(double wi, double du) {
+  double rBin = du / 1E-8;
+  rBin = (rBin > +1) ? +1 : rBin;
+  rBin = (rBin < -1) ? -1 : rBin;
+  return wi * rBin;
+}
+
+template<> inline double ruleVote<VotingRule::PropBin>(double wi, double du) {
+  const double rbp = 0.2;
+  double rBin = du / 1E-8;
+  rBin = (rBin > +1) ? +1 : rBin;
+  rBin = (rBin < -1) ? -1 : rBin;
+  return wi * ((1 - rbp)*du + rbp*rBin);
+}
+
+template<> inline double ruleVote<VotingRule::Proportional>(double wi, double du) {
+  return wi * du;
+}
+
+template<> inline double ruleVote<VotingRule::PropCbc>(double wi, double du) {
+  const double rpc = 0.5;
+  return wi * ((1 - rpc)*du + rpc*(du * du * du));
+}
+
+template<> inline double ruleVote<VotingRule::Cubic>(double wi, double du) {
+  return wi * (du * du * du);
+}
+
+template<> inline double ruleVote<VotingRule::ASymProsp>(double wi, double du) {
+  return (du < 0.0) ? wi * du : ((0.0 < du) ? (2.0 * wi * du) / 3.0 : 0.0);
+}
+
+// ut is u transposed, so ut[i*numAct + k] = u(k,i) and the k-loop is contiguous.
+// Adding max(v,0) rather than branching on the sign gives the same sums as
+// Model::coalitions, in the same order, and lets the compiler vectorize over k.
+template<VotingRule VR>
+KMatrix coalitionKernel(const vector<double> & w, const vector<double> & ut,
+                        unsigned int numAct, unsigned int numOpt) {
+  const double minC = 1E-8;
+  auto c = KMatrix(numOpt, numOpt);
+  for (unsigned int i = 0; i < numOpt; i++) {
+    const double * ui = ut.data() + i * numAct;
+    for (unsigned int j = 0; j < i; j++) {
+      const double * uj = ut.data() + j * numAct;
+      double cij = minC;
+      double cji = minC;
+      for (unsigned int k = 0; k < numAct; k++) {
+        const double vkij = ruleVote<VR>(w[k], ui[k] - uj[k]);
+        cij = cij + ((vkij > 0) ? vkij : 0.0);
+        cji = cji - ((vkij < 0) ? vkij : 0.0);
+      }
+      c(i, j) = cij;
+      c(j, i) = cji;
+    }
+    c(i, i) = minC;
+  }
+  return c;
+}
+
 tuple<double, double> Model::vProb(VPModel vpm, const double s1, const double s2) {
   const double tol = 1E-8;
   const double minX = 1E-6;
@@ -542,13 +680,157 @@ KMatrix Model::coalitions(function<double(unsigned int ak, unsigned int pi, unsi
   return c;
 }
 
+KMatrix Model::coalitions(VotingRule vr, const KMatrix & w, const KMatrix & u) {
+  const unsigned int numAct = u.numR();
+  const unsigned int numOpt = u.numC();
+  if ((1 != w.numR()) || (numAct != w.numC())) {
+    throw KException("Model::coalitions: weights must be a row-vector with one entry per actor");
+  }
+  auto wv = vector<double>(numAct);
+  for (unsigned int k = 0; k < numAct; k++) {
+    wv[k] = w(0, k);
+    if (wv[k] <= 0.0) { // same check as vote, made once per actor
+      throw KException("Model::coalitions - non-positive voting weight");
+    }
+  }
+  auto ut = vector<double>(numAct * numOpt);
+  for (unsigned int k = 0; k < numAct; k++) {
+    for (unsigned int i = 0; i < numOpt; i++) {
+      ut[i * numAct + k] = u(k, i);
+    }
+  }
+
+  switch (vr) {
+  case VotingRule::Binary:
+    return coalitionKernel<VotingRule::Binary>(wv, ut, numAct, numOpt);
+  case VotingRule::PropBin:
+    return coalitionKernel<VotingRule::PropBin>(wv, ut, numAct, numOpt);
+  case VotingRule::Proportional:
+    return coalitionKernel<VotingRule::Proportional>(wv, ut, numAct, numOpt);
+  case VotingRule::PropCbc:
+    return coalitionKernel<VotingRule::PropCbc>(wv, ut, numAct, numOpt);
+  case VotingRule::Cubic:
+    return coalitionKernel<VotingRule::Cubic>(wv, ut, numAct, numOpt);
+  case VotingRule::ASymProsp:
+    return coalitionKernel<VotingRule::ASymProsp>(wv, ut, numAct, numOpt);
+  default:
+    throw KException("Model::coalitions - Unrecognized VotingRule");
+  }
+}
+
+// Same sums as coalitionKernel, for nb problems of one shape at once:
+// w[k*nb + b], u[(i*numAct + k)*nb + b], c[(i*numOpt + j)*nb + b].
+// The innermost loop runs across problems, so it vectorizes even when numAct is tiny.
+template<VotingRule VR>
+void coalitionBatchKernel(const vector<double> & w, const vector<double> & u,
+                          unsigned int numAct, unsigned int numOpt, unsigned int nb,
+                          vector<double> & c) {
+  const double minC = 1E-8;
+  auto cij = vector<double>(nb);
+  auto cji = vector<double>(nb);
+  for (unsigned int i = 0; i < numOpt; i++) {
+    for (unsigned int j = 0; j < i; j++) {
+      std::fill(cij.begin(), cij.end(), minC);
+      std::fill(cji.begin(), cji.end(), minC);
+      for (unsigned int k = 0; k < numAct; k++) {
+        const double * wk = w.data() + k * nb;
+        const double * uik = u.data() + (i * numAct + k) * nb;
+        const double * ujk = u.data() + (j * numAct + k) * nb;
+        for (unsigned int b = 0; b < nb; b++) {
+          const double vkij = ruleVote<VR>(wk[b], uik[b] - ujk[b]);
+          cij[b] = cij[b] + ((vkij > 0) ? vkij : 0.0);
+          cji[b] = cji[b] - ((vkij < 0) ? vkij : 0.0);
+        }
+      }
+      std::copy(cij.begin(), cij.end(), c.begin() + (i * numOpt + j) * nb);
+      std::copy(cji.begin(), cji.end(), c.begin() + (j * numOpt + i) * nb);
+    }
+    std::fill(c.begin() + (i * numOpt + i) * nb, c.begin() + (i * numOpt + i + 1) * nb, minC);
+  }
+  return;
+}
+
+vector<KMatrix> Model::coalitions(VotingRule vr, const vector<KMatrix> & ws, const vector<KMatrix> & us) {
+  if (ws.size() != us.size()) {
+    throw KException("Model::coalitions: need one weight vector per utility matrix");
+  }
+  // group the problems by shape
+  auto shapes = std::map<std::pair<unsigned int, unsigned int>, vector<unsigned int>>();
+  for (unsigned int n = 0; n < us.size(); n++) {
+    const auto & w = ws[n];
+    const auto & u = us[n];
+    if ((1 != w.numR()) || (u.numR() != w.numC())) {
+      throw KException("Model::coalitions: weights must be a row-vector with one entry per actor");
+    }
+    shapes[std::make_pair(u.numR(), u.numC())].push_back(n);
+  }
+
+  auto cs = vector<KMatrix>(us.size());
+  for (const auto & sh : shapes) {
+    const unsigned int numAct = sh.first.first;
+    const unsigned int numOpt = sh.first.second;
+    const auto & ndx = sh.second;
+    const unsigned int nb = ndx.size();
+
+    auto wp = vector<double>(numAct * nb);
+    auto up = vector<double>(numOpt * numAct * nb);
+    for (unsigned int b = 0; b < nb; b++) {
+      const auto & w = ws[ndx[b]];
+      const auto & u = us[ndx[b]];
+      for (unsigned int k = 0; k < numAct; k++) {
+        wp[k * nb + b] = w(0, k);
+        if (wp[k * nb + b] <= 0.0) {
+          throw KException("Model::coalitions - non-positive voting weight");
+        }
+        for (unsigned int i = 0; i < numOpt; i++) {
+          up[(i * numAct + k) * nb + b] = u(k, i);
+        }
+      }
+    }
+
+    auto cp = vector<double>(numOpt * numOpt * nb);
+    switch (vr) {
+    case VotingRule::Binary:
+      coalitionBatchKernel<VotingRule::Binary>(wp, up, numAct, numOpt, nb, cp);
+      break;
+    case VotingRule::PropBin:
+      coalitionBatchKernel<VotingRule::PropBin>(wp, up, numAct, numOpt, nb, cp);
+      break;
+    case VotingRule::Proportional:
+      coalitionBatchKernel<VotingRule::Proportional>(wp, up, numAct, numOpt, nb, cp);
+      break;
+    case VotingRule::PropCbc:
+      coalitionBatchKernel<VotingRule::PropCbc>(wp, up, numAct, numOpt, nb, cp);
+      break;
+    case VotingRule::Cubic:
+      coalitionBatchKernel<VotingRule::Cubic>(wp, up, numAct, numOpt, nb, cp);
+      break;
+    case VotingRule::ASymProsp:
+      coalitionBatchKernel<VotingRule::ASymProsp>(wp, up, numAct, numOpt, nb, cp);
+      break;
+    default:
+      throw KException("Model::coalitions - Unrecognized VotingRule");
+    }
+
+    for (unsigned int b = 0; b < nb; b++) {
+      auto c = KMatrix(numOpt, numOpt);
+      for (unsigned int i = 0; i < numOpt; i++) {
+        for (unsigned int j = 0; j < numOpt; j++) {
+          c(i, j) = cp[(i * numOpt + j) * nb + b];
+        }
+      }
+      cs[ndx[b]] = c;
+    }
+  }
+  return cs;
+}
+
 // returns a square matrix of prob(OptI > OptJ)
 // these are assumed to be unique options.
 // w is a [1,actor] row-vector of actor strengths, u is [act,option] utilities.
 KMatrix Model::vProb(VotingRule vr, VPModel vpm, const KMatrix & w, const KMatrix & u) {
   // u_ij is utility to actor i of the position advocated by actor j
   unsigned int numAct = u.numR();
-  unsigned int numOpt = u.numC();
   // w_j is row-vector of actor weights, for simple voting
   if (numAct != w.numC()) { // require 1-to-1 matching of actors and strengths
     throw KException("Model::vProb: weight matrix's column size must be equal to number of actors");
@@ -557,12 +839,7 @@ KMatrix Model::vProb(VotingRule vr, VPModel vpm, const KMatrix & w, const KMatri
     throw KException("Model::vProb: weights must be a row-vector");
   }
 
-  auto vfn = [vr, &w, &u](unsigned int k, unsigned int i, unsigned int j) {
-    double vkij = vote(vr, w(0, k), u(k, i), u(k, j));
-    return vkij;
-  };
-
-  auto c = coalitions(vfn, numAct, numOpt); // c(i,j) = strength of coaltion for i against j
+  auto c = coalitions(vr, w, u); // c(i,j) = strength of coaltion for i against j
   KMatrix p = vProb(vpm, c);  // p(i,j) = prob Ai defeats Aj
   return p;
 }
@@ -676,57 +953,28 @@ KMatrix Model::markovIncentivePCE(const KMatrix & coalitions, VPModel vpm) {
 
   const auto chlgProbMatrix = KMatrix::map(cpFn, numOpt, numOpt);
 
-  // probability starts as uniform distribution (column vector)
-  auto p = KMatrix(numOpt, 1, 1.0) / numOpt;  // all 1/n
-  auto q = p;
-  unsigned int iMax = 1000;  // 10-30 is typical
-  unsigned int iter = 0;
-  double change = 1.0;
-
-  // do the markov calculation
-  while (pTol < change)  { // && (iter < iMax)
-    if (printP) {
-      LOG(INFO) << "Iteration" << iter << "/" << iMax;
-      LOG(INFO) << "pDist:";
-      trans(p).mPrintf(" %.4f");
-      LOG(INFO) << KBase::getFormattedString("change: %.4e", change);
-    }
-    auto ct = KMatrix(numOpt, numOpt);
-    for (unsigned int i = 0; i < numOpt; i++) {
-      for (unsigned int j = 0; j < numOpt; j++) {
-        // See "Markov Voting with Incentives in KTAB" paper
-        ct(i, j) = p(i, 0) * chlgProbMatrix(j, i);
-      }
-    }
-    if (printP) {
-      LOG(INFO) << "Ct:";
-      ct.mPrintf("  %.3f");
-    }
-    change = 0.0;
-    for (unsigned int i = 0; i < numOpt; i++) {
-      double qi = 0.0;
-      for (unsigned int j = 0; j < numOpt; j++) {
-        double vij = victProbMatrix(i, j);
-        double cj = ct(i, j) + ct(j, i);
-        qi = qi + vij* cj;
-      }
-      if (0 > qi) {
-        throw KException("Model::markovIncentivePCE: Probability qi must be non-negative");
-      }
-      q(i, 0) = qi;
-      double c = fabs(q(i, 0) - p(i, 0));
-      change = (c > change) ? c : change;
-    }
-    // Newton method improves convergence.
-    p = (p+q)/2.0;
-    iter++;
-    if (fabs(sum(p) - 1.0) >= pTol) {
-      throw KException("Model::markovIncentivePCE: Sum total of prob p must be less than 1.0");
+  // The update in the "Markov Voting with Incentives in KTAB" paper,
+  //   q(i) = sum_j v(i,j) * (p(i)*P[j->i] + p(j)*P[i->j]),
+  // is linear in p, so build its matrix once: q = M p.
+  // Each column of M sums to 1 because v(i,j) + v(j,i) = 1.
+  auto markovM = KMatrix(numOpt, numOpt);
+  for (unsigned int i = 0; i < numOpt; i++) {
+    for (unsigned int j = 0; j < numOpt; j++) {
+      const double vij = victProbMatrix(i, j);
+      markovM(i, i) = markovM(i, i) + vij * chlgProbMatrix(j, i);
+      markovM(i, j) = markovM(i, j) + vij * chlgProbMatrix(i, j);
     }
   }
+  if (printP) {
+    LOG(INFO) << "Transition matrix:";
+    markovM.mPrintf("  %.3f");
+  }
 
-  if (iter >= iMax) { // no way to recover
-    throw KException("Model::markovIncentivePCE: Iteration exceeded upper limit");
+  const unsigned int iMax = 1000;  // 10-30 is typical
+  const auto p = markovStationary(markovM, pTol, iMax);
+  if (printP) {
+    LOG(INFO) << "pDist:";
+    trans(p).mPrintf(" %.4f");
   }
   return p;
 }
@@ -756,62 +1004,264 @@ KMatrix Model::markovIncentivePCE(const KMatrix & coalitions, VPModel vpm) {
 KMatrix Model::markovUniformPCE(const KMatrix & pv) {
   const double pTol = 1E-6;
   unsigned int numOpt = pv.numR();
-  auto p = KMatrix(numOpt, 1, 1.0) / numOpt;  // all 1/n
-  auto q = p;
-  unsigned int iMax = 1000;  // 10-30 is typical
+  // q(i) = sum_j pv(i,j) * (p(i) + p(j)) / n, as a matrix: q = M p
+  auto markovM = KMatrix(numOpt, numOpt);
+  for (unsigned int i = 0; i < numOpt; i++) {
+    for (unsigned int j = 0; j < numOpt; j++) {
+      markovM(i, i) = markovM(i, i) + pv(i, j) / numOpt;
+      markovM(i, j) = markovM(i, j) + pv(i, j) / numOpt;
+    }
+  }
+  const unsigned int iMax = 1000;  // 10-30 is typical
+  return markovStationary(markovM, pTol, iMax);
+}
+
+
+KMatrix Model::markovStationary(const KMatrix & trans, double pTol, unsigned int iMax,
+                                MarkovSolveInfo * info) {
+  const unsigned int n = trans.numR();
+  if ((0 == n) || (n != trans.numC())) {
+    throw KException("Model::markovStationary: transition matrix must be square and non-empty");
+  }
+  auto m = vector<double>(n * n); // row-major copy
+  for (unsigned int i = 0; i < n; i++) {
+    for (unsigned int j = 0; j < n; j++) {
+      m[i * n + j] = trans(i, j);
+      if (0 > m[i * n + j]) {
+        throw KException("Model::markovStationary: transition probabilities must be non-negative");
+      }
+    }
+  }
+
+  auto residual = [&m, n](const vector<double> & x) {
+    double r = 0.0;
+    for (unsigned int i = 0; i < n; i++) {
+      double mx = 0.0;
+      for (unsigned int j = 0; j < n; j++) {
+        mx = mx + m[i * n + j] * x[j];
+      }
+      const double c = fabs(mx - x[i]);
+      r = (c > r) ? c : r;
+    }
+    return r;
+  };
+
+  // Direct solve of (M - I) p = 0 with sum(p) = 1 replacing the last
+  // (redundant) equation, by Gaussian elimination with partial pivoting.
+  // A tiny pivot means the stationary distribution is not unique, in which
+  // case the answer depends on the starting point and we iterate instead.
+  auto x = vector<double>(n, 0.0);
+  bool directP = true;
+  {
+    const unsigned int nc = n + 1;
+    auto a = vector<double>(n * nc);
+    for (unsigned int i = 0; i < n; i++) {
+      for (unsigned int j = 0; j < n; j++) {
+        a[i * nc + j] = (i + 1 < n) ? (m[i * n + j] - ((i == j) ? 1.0 : 0.0)) : 1.0;
+      }
+      a[i * nc + n] = (i + 1 < n) ? 0.0 : 1.0;
+    }
+    const double minPivot = 1E-12;
+    for (unsigned int c = 0; directP && (c < n); c++) {
+      unsigned int pr = c;
+      for (unsigned int r = c + 1; r < n; r++) {
+        if (fabs(a[r * nc + c]) > fabs(a[pr * nc + c])) {
+          pr = r;
+        }
+      }
+      if (fabs(a[pr * nc + c]) < minPivot) {
+        directP = false;
+        break;
+      }
+      if (pr != c) {
+        for (unsigned int j = c; j < nc; j++) {
+          std::swap(a[pr * nc + j], a[c * nc + j]);
+        }
+      }
+      for (unsigned int r = c + 1; r < n; r++) {
+        const double f = a[r * nc + c] / a[c * nc + c];
+        if (0.0 != f) {
+          for (unsigned int j = c; j < nc; j++) {
+            a[r * nc + j] = a[r * nc + j] - f * a[c * nc + j];
+          }
+        }
+      }
+    }
+    for (unsigned int c = n; directP && (0 < c); c--) {
+      const unsigned int i = c - 1;
+      double s = a[i * nc + n];
+      for (unsigned int j = i + 1; j < n; j++) {
+        s = s - a[i * nc + j] * x[j];
+      }
+      x[i] = s / a[i * nc + i];
+    }
+    if (directP) {
+      double sx = 0.0;
+      for (unsigned int i = 0; i < n; i++) {
+        if (x[i] < -pTol) {
+          directP = false;
+        }
+        x[i] = (x[i] < 0.0) ? 0.0 : x[i]; // round-off only
+        sx = sx + x[i];
+      }
+      directP = directP && (0.0 < sx);
+      for (unsigned int i = 0; directP && (i < n); i++) {
+        x[i] = x[i] / sx;
+      }
+      directP = directP && (residual(x) <= pTol);
+    }
+  }
+
   unsigned int iter = 0;
-  double change = 1.0;
-  while (pTol < change) {
-    change = 0;
-    for (unsigned int i = 0; i < numOpt; i++) {
-      double pi = 0.0;
-      for (unsigned int j = 0; j < numOpt; j++) {
-        pi = pi + pv(i, j)*(p(i, 0) + p(j, 0));
+  if (!directP) {
+    // damped fixed-point iteration, starting from the uniform distribution
+    auto q = vector<double>(n);
+    x.assign(n, 1.0 / n);
+    double change = 1.0;
+    while ((pTol < change) && (iter < iMax)) {
+      change = 0.0;
+      for (unsigned int i = 0; i < n; i++) {
+        double qi = 0.0;
+        for (unsigned int j = 0; j < n; j++) {
+          qi = qi + m[i * n + j] * x[j];
+        }
+        q[i] = qi;
+        const double c = fabs(qi - x[i]);
+        change = (c > change) ? c : change;
       }
-      if (0 > pi) { // double-check
-        throw KException("Model::markovUniformPCE: Probability pi must be non-negative");
+      for (unsigned int i = 0; i < n; i++) {
+        x[i] = (x[i] + q[i]) / 2.0;
       }
-      q(i, 0) = pi / numOpt;
-      double c = fabs(q(i, 0) - p(i, 0));
-      change = (c > change) ? c : change;
+      iter++;
     }
-    // Newton method improves convergence.
-    p = (p + q) / 2.0;
-    iter++;
-    if (fabs(sum(p) - 1.0) >= pTol) { // double-check
-      throw KException("Model::markovUniformPCE: Sum total of probabilities must be less than 1.0");
+    if (pTol < change) { // no way to recover
+      throw KException(KBase::getFormattedString(
+                         "Model::markovStationary: no convergence in %u iterations (n=%u, change %.3e, tol %.1e)",
+                         iter, n, change, pTol));
     }
   }
-  if (iter >= iMax) { // no way to recover
-    throw KException("Model::markovUniformPCE: Iteration exceeded the upper limit");
+
+  auto p = KMatrix(n, 1);
+  for (unsigned int i = 0; i < n; i++) {
+    p(i, 0) = x[i];
+  }
+  if (fabs(sum(p) - 1.0) >= pTol) { // double-check
+    throw KException("Model::markovStationary: Sum total of probabilities must be 1.0");
+  }
+  if (nullptr != info) {
+    info->direct = directP;
+    info->iterations = iter;
+    info->residual = residual(x);
   }
   return p;
 }
 
 
 // Given square matrix of Prob[i>j] returns a column vector for Prob[i].
-// Uses 1-step conditional probabilities, not Markov process
+// Uses 1-step conditional probabilities, not Markov process.
+// The products over j are formed as sums of logs, then normalized with the
+// log-sum-exp shift, so hundreds of options do not underflow to zero.
 KMatrix Model::condPCE(const KMatrix & pv) {
-  unsigned int numOpt = pv.numR();
-  auto p = KMatrix(numOpt, 1);
-  for (unsigned int i = 0; i < numOpt; i++) {
-    double pi = 1.0;
-    for (unsigned int j = 0; j < numOpt; j++) {
-      pi = pi * pv(i, j);
+  const unsigned int numOpt = pv.numR();
+  if (numOpt != pv.numC()) {
+    throw KException("Model::condPCE: pv must be a square matrix");
+  }
+  const vector<double> pvr(pv.begin(), pv.end()); // row-major
+  for (double pij : pvr) {
+    if (0 > pij || 1 < pij) {
+      throw KException("Model::condPCE: value of probability pv(i,j) must be within [0,1]");
     }
-    // double-check
-    if (0 > pi || 1 < pi) {
-      throw KException("Model::condPCE: value of probability pi must be within [0,1]");
+  }
+
+  auto lp = vector<double>(numOpt);
+  auto rowFn = [&pvr, &lp, numOpt](unsigned int iLow, unsigned int iHigh) {
+    for (unsigned int i = iLow; i < iHigh; i++) {
+      const double * pvi = pvr.data() + i * numOpt;
+      double li = 0.0;
+      for (unsigned int j = 0; j < numOpt; j++) {
+        li = li + log(pvi[j]); // -inf when pv(i,j) is 0
+      }
+      lp[i] = li; // log of probability that i beats all alternatives
     }
+    return;
+  };
+  // threads only pay off for very large option sets
+  const unsigned int parMinOpt = 512;
+  const unsigned int rowsPerThread = 128;
+  if (numOpt < parMinOpt) {
+    rowFn(0, numOpt);
+  }
+  else {
+    const unsigned int numBlk = (numOpt + rowsPerThread - 1) / rowsPerThread;
+    auto blkFn = [&rowFn, numOpt, rowsPerThread](unsigned int b) {
+      const unsigned int hi = (b + 1) * rowsPerThread;
+      rowFn(b * rowsPerThread, (hi < numOpt) ? hi : numOpt);
+    };
+    KBase::groupThreads(blkFn, 0, numBlk - 1);
+  }
 
-    p(i, 0) = pi; // probability that i beats all alternatives
+  double lMax = -std::numeric_limits<double>::infinity();
+  for (double li : lp) {
+    lMax = (li > lMax) ? li : lMax;
+  }
+  if (!std::isfinite(lMax)) {
+    throw KException("Model::condPCE: no option has a positive probability of beating all alternatives");
+  }
+  auto p = KMatrix(numOpt, 1);
+  double probOne = 0.0; // scaled probability that one option, any option, beats all alternatives
+  for (unsigned int i = 0; i < numOpt; i++) {
+    p(i, 0) = exp(lp[i] - lMax);
+    probOne = probOne + p(i, 0);
   }
-  double probOne = sum(p); // probability that one option, any option, beats all alternatives
   p = (p / probOne); // conditional probability that i is that one.
   return p;
 }
 
 
+// shared by both scalarPCE overloads.
+// The report is formatted into a buffer owned by the calling thread, and the
+// mutex is held only while emitting it, so concurrent PCEs do not serialize.
+static void logScalarPCE(unsigned int numAct, unsigned int numOpt, const KMatrix & w, const KMatrix & u,
+                         VotingRule vr, const KMatrix & c, const KMatrix & pv, const KMatrix & p,
+                         ReportingLevel rl) {
+  if (ReportingLevel::Low >= rl) { // fast path: nothing to report, so no formatting and no lock
+    return;
+  }
+  auto lines = vector<string>();
+  auto addRows = [&lines](const KMatrix & m, const char * fs) {
+    for (unsigned int i = 0; i < m.numR(); i++) {
+      string row;
+      for (unsigned int j = 0; j < m.numC(); j++) {
+        row += KBase::getFormattedString(fs, m(i, j));
+      }
+      lines.push_back(row);
+    }
+  };
+  lines.push_back("Num actors:" + std::to_string(numAct));
+  lines.push_back("Num options:" + std::to_string(numOpt));
+  if ((numAct <= 20) && (numOpt <= 20)) {
+    lines.push_back("Actor strengths:");
+    addRows(w, " %6.2f ");
+    lines.push_back("Voting rule:" + nameFromEnum<VotingRule>(vr, VotingRuleNames));
+    lines.push_back("Utility to actors of options:");
+    addRows(u, " %+8.3f ");
+
+    lines.push_back("Coalition strengths of (i:j):");
+    addRows(c, " %8.3f ");
+
+    lines.push_back("Probability Opt_i > Opt_j");
+    addRows(pv, " %.4f ");
+    lines.push_back("Probability Opt_i");
+    addRows(p, " %.4f ");
+  }
+  lines.push_back("Found stable PCE distribution");
+
+  std::lock_guard<std::mutex> lk(mtx_spce_log); // keep one report's lines together
+  for (const auto & ln : lines) {
+    LOG(INFO) << ln;
+  }
+}
+
 // calculate the [option,1] column vector of option-probabilities.
 // w is a [1,actor] row-vector of actor strengths, u is [act,option] utilities.
 // This assumes scalar capabilities of actors (w), so that the voting strength
@@ -827,36 +1277,30 @@ KMatrix Model::scalarPCE(unsigned int numAct, unsigned int numOpt, const KMatrix
     double vkij = vote(vr, w(0, k), u(k, i), u(k, j));
     return vkij;
   };
-  const auto c = coalitions(vfn, numAct, numOpt); // c(i,j) = strength of coaltion for i against j
+  // c(i,j) = strength of coaltion for i against j; the fast kernel needs u to be exactly [numAct, numOpt]
+  const auto c = ((numAct == u.numR()) && (numOpt == u.numC()) && (numAct == w.numC()))
+                 ? coalitions(vr, w, u) : coalitions(vfn, numAct, numOpt);
   const auto pv2 = Model::probCE2(pcem, vpm, c);
   const auto p = get<0>(pv2); //column
   const auto pv = get<1>(pv2); // square
 
-  mtx_spce_log.lock();
-  if (ReportingLevel::Low < rl) {
-    LOG(INFO) << "Num actors:" << numAct;
-    LOG(INFO) << "Num options:" << numOpt;
-
-    if ((numAct <= 20) && (numOpt <= 20)) {
-      LOG(INFO) << "Actor strengths:";
-      w.mPrintf(" %6.2f ");
-      LOG(INFO) << "Voting rule:" << vr;
-      // printf("         aka %s \n", KBase::vrName(vr).c_str());
-      LOG(INFO) << "Utility to actors of options:";
-      u.mPrintf(" %+8.3f ");
-
-      LOG(INFO) << "Coalition strengths of (i:j):";
-      c.mPrintf(" %8.3f ");
+  logScalarPCE(numAct, numOpt, w, u, vr, c, pv, p, rl);
+  return p;
+}
 
-      LOG(INFO) << "Probability Opt_i > Opt_j";
-      pv.mPrintf(" %.4f ");
-      LOG(INFO) << "Probability Opt_i";
-      p.mPrintf(" %.4f ");
-    }
-    LOG(INFO) << "Found stable PCE distribution";
+vector<KMatrix> Model::scalarPCE(const vector<KMatrix> & ws, const vector<KMatrix> & us,
+                                 VotingRule vr, VPModel vpm, PCEModel pcem, ReportingLevel rl) {
+  const auto cs = coalitions(vr, ws, us); // one kernel pass per problem shape
+  auto ps = vector<KMatrix>();
+  ps.reserve(cs.size());
+  for (unsigned int n = 0; n < cs.size(); n++) {
+    const auto pv2 = Model::probCE2(pcem, vpm, cs[n]);
+    const auto p = get<0>(pv2); //column
+    const auto pv = get<1>(pv2); // square
+    logScalarPCE(us[n].numR(), us[n].numC(), ws[n], us[n], vr, cs[n], pv, p, rl);
+    ps.push_back(p);
   }
-  mtx_spce_log.unlock();
-  return p;
+  return ps;
 }
 
 
@@ -966,6 +1410,7 @@ double Actor::vProbLittle(VotingRule vr, double wn, double uni, double unj, doub
 void Model::configLogger(string logFile) {
   el::Configurations confFromFile(logFile);
   el::Loggers::reconfigureAllLoggers(confFromFile);
+  KLog::refresh();
 }
 
 } // end of namespace
@@ -44,10 +44,13 @@
 #include "kutils.h"
 #include "kmatrix.h"
 #include "prng.h"
+#include "klog.h"
+#include "kmetrics.h"
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <map>
 #include <memory>
+#include <iostream>
 
 namespace KBase {
 using std::ostream;
@@ -270,6 +273,9 @@ public:
   void randomize(PRNG* rng);
   MtchGene * mutate(PRNG * rng) const;
   tuple<MtchGene*, MtchGene*> cross(const MtchGene * g2, PRNG * rng) const;
+  // as mutate and cross, but overwriting existing genes, which reuses their storage
+  void mutateInto(MtchGene * mg2, PRNG * rng) const;
+  void crossInto(const MtchGene * g2, MtchGene * gA, MtchGene * gB, PRNG * rng) const;
   //void show() const;
   bool equiv(const MtchGene * g2) const;
 
@@ -285,6 +291,18 @@ protected:
 
 
 // -------------------------------------------------
+// Binary read/write of primitive values, for use in checkpoint files.
+// Values are stored in the native byte order, so a checkpoint is
+// only meant to be read on the same platform which wrote it.
+void ckptPutU64(ostream & os, uint64_t x);
+void ckptPutDbl(ostream & os, double x);
+void ckptPutStr(ostream & os, const string & x);
+void ckptPutMat(ostream & os, const KMatrix & m);
+uint64_t ckptGetU64(std::istream & is);
+double ckptGetDbl(std::istream & is);
+string ckptGetStr(std::istream & is);
+KMatrix ckptGetMat(std::istream & is);
+
 class Model {
 public:
 
@@ -338,6 +356,15 @@ public:
   static KMatrix coalitions(function<double(unsigned int ak, unsigned int pi, unsigned int pj)> vfn,
                             unsigned int numAct, unsigned int numOpt);
 
+  // same result as coalitions with a vfn of vote(vr, w(0,k), u(k,i), u(k,j)),
+  // but with the voting rule resolved at compile time and a contiguous loop over actors.
+  // w is a [1,actor] row-vector of actor strengths, u is [act,option] utilities.
+  static KMatrix coalitions(VotingRule vr, const KMatrix & w, const KMatrix & u);
+
+  // coalitions(vr, ws[n], us[n]) for every n. Problems of the same shape are packed
+  // together, problem-index innermost, so one pass of the kernel serves all of them.
+  static vector<KMatrix> coalitions(VotingRule vr, const vector<KMatrix> & ws, const vector<KMatrix> & us);
+
   // calculate pv[i>j] from coalitions
   // c[i,j] is the strength of coalition supporting OptI over OptJ
   static KMatrix vProb(VPModel vpm, const KMatrix & c);
@@ -361,9 +388,28 @@ public:
   static KMatrix scalarPCE(unsigned int numAct, unsigned int numOpt, const KMatrix & w,
                            const KMatrix & u, VotingRule vr, VPModel vpm, PCEModel pcem, ReportingLevel rl);
 
+  // scalarPCE for many small problems at once; ws[n] is [1,actor] and us[n] is [actor,option].
+  // Returns the [option,1] distribution of each problem, in order.
+  static vector<KMatrix> scalarPCE(const vector<KMatrix> & ws, const vector<KMatrix> & us,
+                                   VotingRule vr, VPModel vpm, PCEModel pcem, ReportingLevel rl);
+
 
   static KMatrix markovIncentivePCE(const KMatrix & coalitions, VPModel vpm);
 
+  // how markovStationary found its answer
+  struct MarkovSolveInfo {
+    bool direct = false; // true if the linear solve succeeded
+    unsigned int iterations = 0; // fixed-point iterations, if it fell back to them
+    double residual = 0.0; // max |M p - p| of the returned p
+  };
+
+  // stationary distribution p = M p of a column-stochastic [n,n] transition matrix,
+  // as a [n,1] column vector. Solves the linear system directly when the chain has
+  // a unique stationary distribution; otherwise falls back to the damped iteration
+  // p = (p + M p)/2 from the uniform distribution, and throws after iMax iterations.
+  static KMatrix markovStationary(const KMatrix & trans, double pTol, unsigned int iMax,
+                                  MarkovSolveInfo * info = nullptr);
+
   virtual unsigned int addActor(Actor* a); // returns new number of actors, always at least 1
   int actrNdx(const Actor* a) const;
 
@@ -372,6 +418,27 @@ public:
   // you have to provide this λ-fn
   function <bool(unsigned int iter, const State* s)> stop = nullptr;
 
+  // Streaming mode: if histWindow is non-zero, run() passes each State to
+  // flushState as soon as it is finished, then deletes it (leaving a nullptr
+  // in history), so only states 0 and 1 plus the last histWindow states stay in memory.
+  // The stop λ-fn must therefore look only at those states, as smpStopFn does.
+  // Every state is flushed exactly once, in turn order, by the end of run().
+  // With the default of 0, the entire history is kept and nothing is flushed.
+  unsigned int histWindow = 0;
+  function <void(unsigned int t, const State* s)> flushState = nullptr;
+
+  // Checkpointing: if ckptEvery is non-zero, run() saves the model to ckptFile
+  // every ckptEvery turns. A freshly constructed model can then loadCheckpoint,
+  // and run() continues from that turn exactly as the original run would have.
+  // Only states 0, 1, and the latest are saved, so the other turns in history are nullptr.
+  // With a non-zero histWindow, every earlier turn is flushed before the checkpoint is saved.
+  // Subclasses must implement saveConfig/loadConfig and saveState/loadState.
+  unsigned int ckptEvery = 0;
+  string ckptFile = "";
+  void saveCheckpoint(const string & fName) const;
+  void loadCheckpoint(const string & fName);
+  void resume(const string & fName); // loadCheckpoint, then run
+
   // these should probably be less public and more protected
   vector<Actor*> actrs = {};
   unsigned int numAct = 0;
@@ -470,6 +537,31 @@ protected:
   bool isDB(const QString& databaseName);
 
   static string lastExceptionMsg;
+
+  // states 0 and 1 are always retained, as stopping rules compare against the first step
+  static const unsigned int histKeepFirst = 2;
+  unsigned int histFlushed = 0; // number of states already given to flushState
+
+  // flush finished states and release those outside the retention window.
+  // If finalP, flush everything remaining but release nothing.
+  void releaseHistory(bool finalP);
+
+  // flush, but do not release, the states before turn tEnd not yet flushed
+  void flushHistory(unsigned int tEnd);
+
+  bool resumedP = false; // true after loadCheckpoint, until run() finishes
+
+  // checkpoint to or from a stream, e.g. to copy a model in memory.
+  // States 0, 1, and tLast are written; later turns are not.
+  void writeCheckpoint(ostream & os, unsigned int tLast) const;
+  void readCheckpoint(std::istream & is);
+
+  // model-specific parts of a checkpoint. The default implementations throw,
+  // as not every model supports checkpoints.
+  virtual void saveConfig(ostream & os) const;
+  virtual void loadConfig(std::istream & is);
+  virtual void saveState(ostream & os, const State * s) const;
+  virtual State * loadState(std::istream & is); // must be called when history.size() is the state's turn
 private:
   static KMatrix markovUniformPCE(const KMatrix & pv);
   //static KMatrix markovIncentivePCE(const KMatrix & pv);
@@ -0,0 +1,234 @@
+// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 King Abdullah Petroleum Studies and Research Center
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+// --------------------------------------------
+
+#include <easylogging++.h>
+#include <fstream>
+#include <cstdio>
+
+#include "kmodel.h"
+
+namespace KBase {
+
+using std::ifstream;
+using std::ofstream;
+
+static const string ckptMagic = "KTAB-CKPT-1";
+
+void ckptPutU64(ostream & os, uint64_t x) {
+  os.write((const char*)(&x), sizeof(x));
+  return;
+}
+
+void ckptPutDbl(ostream & os, double x) {
+  os.write((const char*)(&x), sizeof(x));
+  return;
+}
+
+void ckptPutStr(ostream & os, const string & x) {
+  ckptPutU64(os, x.length());
+  os.write(x.data(), x.length());
+  return;
+}
+
+void ckptPutMat(ostream & os, const KMatrix & m) {
+  ckptPutU64(os, m.numR());
+  ckptPutU64(os, m.numC());
+  for (double x : m) {
+    ckptPutDbl(os, x);
+  }
+  return;
+}
+
+uint64_t ckptGetU64(std::istream & is) {
+  uint64_t x = 0;
+  is.read((char*)(&x), sizeof(x));
+  if (!is) {
+    throw KException("ckptGetU64: checkpoint file is truncated");
+  }
+  return x;
+}
+
+double ckptGetDbl(std::istream & is) {
+  double x = 0;
+  is.read((char*)(&x), sizeof(x));
+  if (!is) {
+    throw KException("ckptGetDbl: checkpoint file is truncated");
+  }
+  return x;
+}
+
+string ckptGetStr(std::istream & is) {
+  const uint64_t n = ckptGetU64(is);
+  string x(n, ' ');
+  is.read(&x[0], n);
+  if (!is) {
+    throw KException("ckptGetStr: checkpoint file is truncated");
+  }
+  return x;
+}
+
+KMatrix ckptGetMat(std::istream & is) {
+  const unsigned int nr = ((unsigned int)(ckptGetU64(is)));
+  const unsigned int nc = ((unsigned int)(ckptGetU64(is)));
+  auto m = KMatrix(nr, nc);
+  for (unsigned int i = 0; i < nr; i++) {
+    for (unsigned int j = 0; j < nc; j++) {
+      m(i, j) = ckptGetDbl(is);
+    }
+  }
+  return m;
+}
+
+
+// The checkpoint holds the model configuration, the PRNG engine state,
+// and just the states needed to continue: 0 and 1 (for the stopping rule) and turn tLast.
+void Model::writeCheckpoint(ostream & os, unsigned int tLast) const {
+  if (tLast >= history.size()) {
+    throw KException("Model::writeCheckpoint: no state at the given turn");
+  }
+  ckptPutStr(os, ckptMagic);
+  ckptPutStr(os, scenName);
+  ckptPutStr(os, scenDesc);
+  ckptPutStr(os, scenId);
+  ckptPutU64(os, rngSeed);
+  ckptPutStr(os, rng->getState());
+  ckptPutU64(os, ((uint64_t)vpm));
+  ckptPutU64(os, ((uint64_t)pcem));
+  ckptPutU64(os, ((uint64_t)stm));
+  ckptPutU64(os, histFlushed);
+
+  saveConfig(os);
+
+  vector<unsigned int> turns = { 0 };
+  if (1 < tLast) {
+    turns.push_back(1);
+  }
+  if (0 < tLast) {
+    turns.push_back(tLast);
+  }
+  ckptPutU64(os, turns.size());
+  for (auto t : turns) {
+    const State* st = history[t];
+    if (nullptr == st) {
+      throw KException("Model::writeCheckpoint: state to save is a null pointer");
+    }
+    ckptPutU64(os, t);
+    saveState(os, st);
+  }
+  return;
+}
+
+void Model::readCheckpoint(std::istream & is) {
+  if ((0 != history.size()) || (0 != numAct)) {
+    throw KException("Model::readCheckpoint: model must be empty before loading a checkpoint");
+  }
+  if (ckptMagic != ckptGetStr(is)) {
+    throw KException("Model::readCheckpoint: not a checkpoint");
+  }
+
+  // resumed runs write to the same scenario as the original
+  scenName = ckptGetStr(is);
+  scenDesc = ckptGetStr(is);
+  scenId = ckptGetStr(is);
+  rngSeed = ckptGetU64(is);
+  rng->setState(ckptGetStr(is));
+  vpm = ((VPModel)ckptGetU64(is));
+  pcem = ((PCEModel)ckptGetU64(is));
+  stm = ((StateTransMode)ckptGetU64(is));
+  histFlushed = ((unsigned int)(ckptGetU64(is)));
+
+  loadConfig(is);
+
+  const uint64_t numSaved = ckptGetU64(is);
+  for (uint64_t n = 0; n < numSaved; n++) {
+    const unsigned int t = ((unsigned int)(ckptGetU64(is)));
+    if (t < history.size()) {
+      throw KException("Model::readCheckpoint: saved turns must be increasing");
+    }
+    while (history.size() < t) {
+      history.push_back(nullptr);
+    }
+    State* st = loadState(is);
+    addState(st);
+  }
+  resumedP = true;
+  return;
+}
+
+// It is written to a temporary file first, so that an interruption while
+// writing never leaves a damaged checkpoint in place of the previous one.
+void Model::saveCheckpoint(const string & fName) const {
+  if (0 == history.size()) {
+    throw KException("Model::saveCheckpoint: no states to save");
+  }
+  const string tmpName = fName + ".tmp";
+  ofstream os(tmpName, std::ios::binary | std::ios::trunc);
+  if (!os) {
+    throw KException(string("Model::saveCheckpoint: could not open ") + tmpName);
+  }
+  const unsigned int tLast = ((unsigned int)(history.size())) - 1;
+  writeCheckpoint(os, tLast);
+  os.close();
+  if (!os) {
+    throw KException(string("Model::saveCheckpoint: could not write ") + tmpName);
+  }
+
+  std::remove(fName.c_str()); // rename does not overwrite on every platform
+  if (0 != std::rename(tmpName.c_str(), fName.c_str())) {
+    throw KException(string("Model::saveCheckpoint: could not rename to ") + fName);
+  }
+  LOG(INFO) << "Saved checkpoint at turn" << tLast << "to" << fName;
+  return;
+}
+
+void Model::loadCheckpoint(const string & fName) {
+  ifstream is(fName, std::ios::binary);
+  if (!is) {
+    throw KException(string("Model::loadCheckpoint: could not open ") + fName);
+  }
+  readCheckpoint(is);
+  LOG(INFO) << "Loaded checkpoint of scenario" << scenId << "at turn" << (history.size() - 1);
+  return;
+}
+
+void Model::saveConfig(ostream &) const {
+  throw KException("Model::saveConfig: this model does not support checkpoints");
+}
+
+void Model::loadConfig(std::istream &) {
+  throw KException("Model::loadConfig: this model does not support checkpoints");
+}
+
+void Model::saveState(ostream &, const State *) const {
+  throw KException("Model::saveState: this model does not support checkpoints");
+}
+
+State * Model::loadState(std::istream &) {
+  throw KException("Model::loadState: this model does not support checkpoints");
+}
+
+} // end of namespace
+
+// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
@@ -217,8 +217,13 @@ void  MtchGene::copySelf(MtchGene* mg2) const {
 }
 
 MtchGene * MtchGene::mutate(PRNG * rng) const {
-  // because quid-pro-quo can be expected, we mutate two chromosomes
   auto mg2 = new MtchGene();
+  mutateInto(mg2, rng);
+  return mg2;
+}
+
+void MtchGene::mutateInto(MtchGene * mg2, PRNG * rng) const {
+  // because quid-pro-quo can be expected, we mutate two chromosomes
   copySelf(mg2);
 
   unsigned int n1 = ((unsigned int)(rng->uniform() % numItm));
@@ -229,12 +234,17 @@ MtchGene * MtchGene::mutate(PRNG * rng) const {
   unsigned int a2 = ((unsigned int)(rng->uniform() % numCat));
   mg2->match[n2] = a2;
 
-  return mg2;
+  return;
 }
 
 tuple<MtchGene*, MtchGene*>  MtchGene::cross(const MtchGene * mg2, PRNG * rng) const {
   auto gA = new MtchGene();
   auto gB = new MtchGene();
+  crossInto(mg2, gA, gB, rng);
+  return  tuple<MtchGene*, MtchGene*>(gA, gB);
+}
+
+void MtchGene::crossInto(const MtchGene * mg2, MtchGene * gA, MtchGene * gB, PRNG * rng) const {
   copySelf(gA);
   mg2->copySelf(gB);
   unsigned int nc = crossSite(rng, numItm);
@@ -250,7 +260,7 @@ tuple<MtchGene*, MtchGene*>  MtchGene::cross(const MtchGene * mg2, PRNG * rng) c
       gB->match[i] = c1i;
     }
   }
-  return  tuple<MtchGene*, MtchGene*>(gA, gB);
+  return;
 }
 
 
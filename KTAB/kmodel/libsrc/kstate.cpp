@@ -120,9 +120,7 @@ unsigned int State::myTurn() const {
   auto hLen = ((const unsigned int)(model->history.size()));
   for (unsigned int i = 0; i < hLen; i++) { // cannot use range-for, as I need the value of 'i'
     State* si = model->history[i];
-    if (nullptr == si) {
-      throw KException("State::myTurn: si is a null pointer");
-    }
+    // with a streaming history window, released states are left as nullptr
     if (this == si) {
       t = i;
     }
@@ -181,6 +179,7 @@ void State::setUENdx() {
 
 
 void State::setAUtil(int perspH, ReportingLevel rl) {
+  KPhaseTimer tm("setAUtil");
   // we want to make sure that data is calculated at most once.
   // This is necessary because some utilities are very expensive to calculate,
   // it is easiest to be precise all the time.
@@ -1506,9 +1506,9 @@ KMatrix LeonModel::randomFTax(PRNG* rng) {
   KMatrix ftax = KMatrix(N, 1);
 
   auto makeRand = [this, rng]() {
-    auto tax = KMatrix(N, 1);
+    auto tax = KMatrix::uniform(rng, N, 1, -1, +1);
     for (unsigned int i = 0; i < N; i++) {
-      double ti = rng->uniform(-1, +1);
+      double ti = tax(i, 0);
       if (ti < 0) {
         ti = ti*maxSub;
       }
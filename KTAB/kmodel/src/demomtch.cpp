@@ -542,6 +542,17 @@ void demoMaxSupport(uint64_t s) {
     return g1->mutate(rng);
   };
 
+  // breed into the genes dropped from earlier generations, rather than new ones
+  gOpt->crossInto = [](const MtchGene* g1, const MtchGene* g2, MtchGene* c1, MtchGene* c2, PRNG* rng) {
+    g1->crossInto(g2, c1, c2, rng);
+    return;
+  };
+
+  gOpt->mutateInto = [](const MtchGene* g1, MtchGene* c1, PRNG* rng) {
+    g1->mutateInto(c1, rng);
+    return;
+  };
+
   gOpt->eval = [numC, numI, as, zeta](const MtchGene* mg) {
     if (numC != mg->numCat) {
       throw KException("demoMaxSupport: numC must be equal to numCat of mg");
@@ -562,6 +573,11 @@ void demoMaxSupport(uint64_t s) {
     return mg1->equiv(mg2);
   };
 
+  // bred genes often repeat earlier ones, so remember their values
+  KBase::EvalCache gaMemo;
+  gOpt->hash = [](const MtchGene* mg) { return KBase::EvalCache::hash(mg->match); };
+  gOpt->cache = &gaMemo;
+
   gOpt->makeGene = [numC, numI, as, ps](PRNG * rng) {
     MtchGene* m = new MtchGene();
     m->setState(as, ps);
@@ -916,6 +932,10 @@ tuple<double, MtchPstn> MtchActor::maxProbEUPstn(PropModel pm, const MtchState *
   ghc.eval = assessProbEU;
   ghc.nghbrs = [](MtchPstn mp) { return mp.neighbors(2); };
   ghc.show = showMtchPstn;
+  ghc.numPar = 0; // actors search one at a time, so spread each neighborhood over the cores
+  KBase::EvalCache evalMemo;
+  ghc.hash = [](const MtchPstn mp) { return KBase::EvalCache::hash(mp.match); };
+  ghc.cache = &evalMemo;
 
   auto r0 = ghc.run(*((MtchPstn*)(mst->pstns[ih])), KBase::ReportingLevel::Silent, 100, 1, 0.001);
 
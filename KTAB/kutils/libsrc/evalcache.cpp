@@ -0,0 +1,174 @@
+﻿// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 King Abdullah Petroleum Studies and Research Center
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+// --------------------------------------------
+// Bounded, thread-safe memo of an expensive evaluation.
+// --------------------------------------------
+
+#include <cmath>
+
+#include "evalcache.h"
+
+namespace KBase {
+
+EvalCache::EvalCache(size_t capacity) : shards(numShards), numHits(0), numMisses(0) {
+  if (capacity < 2 * numShards) {
+    throw KException("EvalCache::EvalCache: capacity must be at least two entries per shard");
+  }
+  genCap = capacity / (2 * numShards);
+}
+
+EvalCache::~EvalCache() {
+}
+
+EvalCache::Shard & EvalCache::shardFor(uint64_t key) {
+  // the low bits of a user's hash may be poor, so mix before picking a shard
+  return shards[hashCombine(0, key) % numShards];
+}
+
+bool EvalCache::find(uint64_t key, double & v) {
+  Shard & s = shardFor(key);
+  std::lock_guard<std::mutex> lk(s.mtx);
+  auto it = s.cur.find(key);
+  if (it != s.cur.end()) {
+    v = it->second;
+    numHits++;
+    return true;
+  }
+  it = s.prev.find(key);
+  if (it != s.prev.end()) {
+    v = it->second;
+    numHits++;
+    if (genCap <= s.cur.size()) { // promote it, aging the shard if need be
+      s.prev.swap(s.cur);
+      s.cur.clear();
+    }
+    s.cur[key] = v;
+    return true;
+  }
+  numMisses++;
+  return false;
+}
+
+void EvalCache::insert(uint64_t key, double v) {
+  Shard & s = shardFor(key);
+  std::lock_guard<std::mutex> lk(s.mtx);
+  if (genCap <= s.cur.size()) {
+    s.prev.swap(s.cur);
+    s.cur.clear();
+  }
+  s.cur[key] = v;
+  return;
+}
+
+double EvalCache::getOrEval(uint64_t key, const function<double()> & fn) {
+  double v = 0.0;
+  if (!find(key, v)) {
+    v = fn();
+    insert(key, v);
+  }
+  return v;
+}
+
+void EvalCache::clear() {
+  for (auto & s : shards) {
+    std::lock_guard<std::mutex> lk(s.mtx);
+    s.cur.clear();
+    s.prev.clear();
+  }
+  numHits = 0;
+  numMisses = 0;
+  return;
+}
+
+uint64_t EvalCache::hits() const {
+  return numHits.load();
+}
+
+uint64_t EvalCache::misses() const {
+  return numMisses.load();
+}
+
+double EvalCache::hitRate() const {
+  const double h = numHits.load();
+  const double n = h + numMisses.load();
+  return (0 < n) ? h / n : 0.0;
+}
+
+size_t EvalCache::size() const {
+  size_t n = 0;
+  for (auto & s : shards) {
+    std::lock_guard<std::mutex> lk(s.mtx);
+    n = n + s.cur.size() + s.prev.size();
+  }
+  return n;
+}
+
+size_t EvalCache::capacity() const {
+  return 2 * numShards * genCap;
+}
+
+uint64_t EvalCache::hashCombine(uint64_t h, uint64_t x) {
+  // splitmix64 finalizer of the running hash plus the next word
+  uint64_t z = h + 0x9E3779B97F4A7C15 + x;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+  return z ^ (z >> 31);
+}
+
+uint64_t EvalCache::hash(const VUI & v) {
+  uint64_t h = v.size();
+  for (auto x : v) {
+    h = hashCombine(h, x);
+  }
+  return h;
+}
+
+uint64_t EvalCache::hash(const VBool & v) {
+  uint64_t h = v.size();
+  uint64_t word = 0;
+  for (unsigned int i = 0; i < v.size(); i++) {
+    word = (word << 1) | (v[i] ? 1 : 0);
+    if (63 == (i % 64)) {
+      h = hashCombine(h, word);
+      word = 0;
+    }
+  }
+  return hashCombine(h, word);
+}
+
+uint64_t EvalCache::hash(const KMatrix & m, double quantum) {
+  if (!(0.0 < quantum)) {
+    throw KException("EvalCache::hash: quantum must be positive");
+  }
+  uint64_t h = hashCombine(m.numR(), m.numC());
+  for (double x : m) {
+    const int64_t q = (int64_t)std::llround(x / quantum);
+    h = hashCombine(h, (uint64_t)q);
+  }
+  return h;
+}
+
+} // end of namespace
+
+// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
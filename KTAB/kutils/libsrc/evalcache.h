@@ -0,0 +1,105 @@
+﻿// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 King Abdullah Petroleum Studies and Research Center
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+// -------------------------------------------------
+// A bounded, thread-safe memo of an expensive evaluation, such as the
+// 'eval' of a hill-climbing or genetic search.
+//
+// Points are keyed by a 64-bit hash which the caller supplies, e.g.
+// EvalCache::hash(match) for a matching, or EvalCache::hash(m, q) to
+// quantize the coordinates of a KMatrix. Distinct points that happen to
+// share a hash would share a value, so the hash must cover everything
+// that eval depends on. A cache is only valid for one eval function:
+// do not share one between actors whose evaluations differ.
+//
+// The entries are spread over shards, each with its own mutex. Each shard
+// keeps a current and a previous generation: when the current one fills,
+// it becomes the previous one, and the old previous one is dropped. So the
+// cache never holds more than its capacity, and recently used entries
+// survive.
+// -------------------------------------------------
+#ifndef KBASE_EVALCACHE_H
+#define KBASE_EVALCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "kutils.h"
+#include "kmatrix.h"
+
+namespace KBase {
+
+using std::function;
+using std::vector;
+
+class EvalCache {
+public:
+  explicit EvalCache(size_t capacity = 1 << 16);
+  virtual ~EvalCache();
+  EvalCache(const EvalCache &) = delete;
+  EvalCache & operator=(const EvalCache &) = delete;
+
+  // the cached value for key, if any, else fn(), which is then cached.
+  // fn runs outside any lock, so two threads may both evaluate a new key.
+  double getOrEval(uint64_t key, const function<double()> & fn);
+  bool find(uint64_t key, double & v); // counts a hit or a miss
+  void insert(uint64_t key, double v);
+  void clear(); // also resets the statistics
+
+  uint64_t hits() const;
+  uint64_t misses() const;
+  double hitRate() const; // 0 before the first lookup
+  size_t size() const;
+  size_t capacity() const;
+
+  // hashes for the usual kinds of points
+  static uint64_t hash(const VUI & v);
+  static uint64_t hash(const VBool & v);
+  // coordinates are rounded to multiples of quantum before hashing
+  static uint64_t hash(const KMatrix & m, double quantum);
+  static uint64_t hashCombine(uint64_t h, uint64_t x);
+
+protected:
+  static const unsigned int numShards = 16;
+  struct Shard {
+    mutable std::mutex mtx;
+    std::unordered_map<uint64_t, double> cur;
+    std::unordered_map<uint64_t, double> prev;
+  };
+  Shard & shardFor(uint64_t key);
+
+  vector<Shard> shards;
+  size_t genCap = 0; // entries per generation, per shard
+  std::atomic<uint64_t> numHits;
+  std::atomic<uint64_t> numMisses;
+};
+
+} // end of namespace
+
+// -------------------------------------------------
+#endif
+// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
@@ -30,10 +30,12 @@
 #include <functional>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 #include "prng.h"
 #include "kutils.h"
+#include "evalcache.h"
 #include <easylogging++.h>
 
 namespace KBase {
@@ -71,6 +73,27 @@ public:
   function <GAP* (PRNG* rng)> makeGene = nullptr;
   function <bool(const GAP* g1, const GAP* g2)> equiv = nullptr;
 
+  // Optional hash of a gene; equiv genes must have equal hashes.
+  // If set, dropDups compares only genes with equal hashes, so it takes
+  // O(P) rather than O(P^2) time. With a cache as well, eval is memoized,
+  // so that genes bred again (often, as duplicates are only dropped after
+  // evaluation) are not re-evaluated. The cache is not owned, and must
+  // only ever see this eval.
+  function <uint64_t(const GAP* g1)> hash = nullptr;
+  EvalCache * cache = nullptr;
+
+  // Optional in-place variants of mutate and cross, which overwrite children
+  // recycled from the genes dropped in earlier generations, so that a long run
+  // soon stops allocating genes. They must make the same children as mutate and
+  // cross, with the same draws from rng, and overwrite all of each child's state.
+  // Genes are recycled only when both are set; mutate and cross are still used
+  // when there are not enough spares.
+  function <void(const GAP* g1, GAP* child, PRNG* rng)> mutateInto = nullptr;
+  function <void(const GAP* g1, const GAP* g2, GAP* child1, GAP* child2, PRNG* rng)> crossInto = nullptr;
+
+  // genes bred at a time, as for groupThreads; 1 breeds them in the calling thread
+  unsigned int numPar = 0;
+
   // If you provide the appropriate methods in a GAP class,
   // the lambdas can be quite simple:
   // cross = [](const GAP* g1, const GAP* g2, PRNG* rng) { return g1->cross(g2, rng); };
@@ -87,18 +110,79 @@ protected:
   void crossPop();
   void dropDups();
   void selectPop();
-  vector < tuple<double, GAP* >> gpool = {};
+  // The pool is stored as two parallel arrays, so that sorting and selection
+  // touch only the contiguous values: vals[i] is the value of genes[i].
+  vector<double> vals = {};
+  vector<GAP*> genes = {};
+  vector<GAP*> spares = {}; // dropped genes, for mutateInto and crossInto to overwrite
+  bool recycleP() const;
+  void retire(GAP* g);
   unsigned int pSize = 0;
   double cFrac = 1.0;
   double mFrac = 0.5;
+  double evalGene(const GAP* g);
   GAP* mutateOne(const GAP* g1, PRNG* rng);
   tuple<GAP*, GAP*> crossPair(const GAP* g1, const GAP* g2, PRNG* rng);
-  void cyclicApply(function <void(unsigned int i)> fn, double f);
+  // fn(i, r, kids) makes and evaluates new genes from the i-th, using only r for
+  // randomness. The kids are either empty or numKids spares for fn to overwrite.
+  void cyclicApply(function <vector<tuple<double, GAP*>>(unsigned int i, PRNG* r,
+                                                         const vector<GAP*> & kids)> fn,
+                   double f, unsigned int numKids);
   PRNG* rng = nullptr;
-  std::mutex cycAppMtx;
 
 private:
-  // nothing yet
+  template <class G> friend class GAIslands;
+};
+
+
+// Island-model GA: several GAOpt populations, each evolving on its own thread
+// and drawing only from its own PRNG. After every epoch of generations, each
+// island sends copies of its best genes to the next island around a ring,
+// where they replace the worst. The islands use the same lambdas as GAOpt,
+// which must therefore be thread-safe, and GAP must be copy-constructible.
+// Results depend on the seed, not on the number of threads.
+template <class GAP>
+class GAIslands {
+public:
+  GAIslands(unsigned int numIsl, unsigned int islSize);
+  virtual ~GAIslands();
+  GAIslands(const GAIslands &) = delete;
+  GAIslands & operator=(const GAIslands &) = delete;
+
+  // seeds each island's PRNG from rng, in island order, then fills the islands
+  void fill(PRNG* rng);
+
+  // stability and the iteration limit are counted in generations, but
+  // checked only at the end of each epoch
+  void run(double c, double m, unsigned int epochLen, unsigned int numMigr,
+           unsigned int maxI, double sTh, unsigned int maxS,
+           ReportingLevel srl,
+           unsigned int & iter, unsigned int & sIter);
+
+  // best gene over all islands, still owned by its island
+  tuple<double, GAP* > getBest() const;
+  unsigned int numIslands() const;
+  GAOpt<GAP>* getIsland(unsigned int k) const;
+
+  // as for GAOpt, and shared by all islands
+  function <tuple<GAP*, GAP*>(const GAP* g1, const GAP* g2, PRNG* rng)> cross = nullptr;
+  function <GAP* (const GAP* g1, PRNG* rng)> mutate = nullptr;
+  function <double(const GAP* g1)> eval = nullptr;
+  function <void(const GAP*)> showGene = nullptr;
+  function <GAP* (PRNG* rng)> makeGene = nullptr;
+  function <bool(const GAP* g1, const GAP* g2)> equiv = nullptr;
+  function <uint64_t(const GAP* g1)> hash = nullptr;
+  EvalCache * cache = nullptr;
+  function <void(const GAP* g1, GAP* child, PRNG* rng)> mutateInto = nullptr;
+  function <void(const GAP* g1, const GAP* g2, GAP* child1, GAP* child2, PRNG* rng)> crossInto = nullptr;
+
+  // islands evolved at a time, as for groupThreads
+  unsigned int numPar = 0;
+
+protected:
+  void migrate(unsigned int numMigr);
+  vector<GAOpt<GAP>*> isles = {};
+  vector<PRNG*> rngs = {};
 };
 
 template<class GAP>
@@ -108,12 +192,8 @@ GAOpt<GAP>::GAOpt(unsigned int s) {
   cFrac = 0;
   mFrac = 0;
 
-  gpool = vector< tuple<double, GAP*>>();
-  gpool.resize(pSize);
-
-  for (unsigned int i = 0; i < pSize; i++) {
-    gpool[i] = tuple <double, GAP*>(0, nullptr);
-  }
+  vals = vector<double>(pSize, 0.0);
+  genes = vector<GAP*>(pSize, nullptr);
 
   cross = nullptr;
   mutate = nullptr;
@@ -125,8 +205,11 @@ GAOpt<GAP>::GAOpt(unsigned int s) {
 
 template<class GAP>
 GAOpt<GAP>::~GAOpt() {
-  for (auto pr : gpool) {
-    delete get<1>(pr);
+  for (auto g : genes) {
+    delete g;
+  }
+  for (auto g : spares) {
+    delete g;
   }
 }
 
@@ -194,6 +277,11 @@ void GAOpt<GAP>::run(PRNG* rng, double c, double m,
     LOG(INFO) << getFormattedString("best value: %+.4f", get<0>(pri));
     LOG(INFO) << "best gene: ";
     showGene(get<1>(pri));
+    if ((nullptr != cache) && (nullptr != hash)) {
+      LOG(INFO) << getFormattedString("Eval cache hit rate %.3f (%llu hits, %llu misses)",
+                                      cache->hitRate(), (unsigned long long)cache->hits(),
+                                      (unsigned long long)cache->misses());
+    }
   }
   el::Loggers::addFlag(el::LoggingFlag::AutoSpacing);
   return;
@@ -202,86 +290,116 @@ void GAOpt<GAP>::run(PRNG* rng, double c, double m,
 
 template<class GAP>
 tuple<double, GAP* > GAOpt<GAP>::getNth(unsigned int n) {
-  assert(n < gpool.size()); // check here
-  return gpool[n];
+  assert(n < genes.size()); // check here
+  return tuple<double, GAP*>(vals[n], genes[n]);
 }
 
 template<class GAP>
 void GAOpt<GAP>::sortPop() {
-  auto prBefore = [this] (tuple<double, GAP*> pri, tuple<double, GAP*> prj) {
-    double vi = get<0>(pri);
-    double vj = get<0>(prj);
-    bool pb = (vi > vj);
-    return pb;
+  // Sort a permutation by value, then apply it to both arrays. This moves
+  // each gene pointer once, and gives the same order as sorting the pairs.
+  const unsigned int n = genes.size();
+  auto ndx = vector<unsigned int>(n);
+  for (unsigned int i = 0; i < n; i++) {
+    ndx[i] = i;
+  }
+  auto iBefore = [this](unsigned int i, unsigned int j) {
+    return (vals[i] > vals[j]);
   };
+  std::sort(ndx.begin(), ndx.end(), iBefore);
 
-  /*
-    auto ps = ((const unsigned int)(gpool.size()));
-    for (unsigned int i = 0; i < ps; i++) {
-        for (unsigned int j = i + 1; j < ps; j++) {
-            auto pri = getNth(i);
-            double vi = get<0>(pri);
-            auto prj = getNth(j);
-            double vj = get<0>(prj);
-            if (vi < vj) {
-                gpool[i] = prj;
-                gpool[j] = pri;
-            }
-        }
-    }
-    */
-
-  std::sort(gpool.begin(), gpool.end(), prBefore);
-
+  auto sVals = vector<double>(n);
+  auto sGenes = vector<GAP*>(n);
+  for (unsigned int k = 0; k < n; k++) {
+    sVals[k] = vals[ndx[k]];
+    sGenes[k] = genes[ndx[k]];
+  }
+  vals.swap(sVals);
+  genes.swap(sGenes);
   return;
 }
 
 template<class GAP>
 void GAOpt<GAP>::dropDups() {
-  auto cSize = ((const unsigned int)(gpool.size()));
+  auto cSize = ((const unsigned int)(genes.size()));
   VBool unique = {};
   unique.resize(cSize);
   for (unsigned int i = 0; i < cSize; i++) {
     unique[i] = true;
   }
-  for (unsigned int i = 0; i < cSize; i++) {
-    GAP* gi = get<1>(getNth(i));
-    for (unsigned int j = 0; j < i; j++) {
-      GAP* gj = get<1>(getNth(j));
-      if (equiv(gi, gj)) {
-        unique[i] = false;
+  if (nullptr != hash) {
+    // compare each gene only with the earlier unique genes of the same hash
+    auto seen = std::unordered_map<uint64_t, vector<unsigned int>>();
+    seen.reserve(cSize);
+    for (unsigned int i = 0; i < cSize; i++) {
+      GAP* gi = get<1>(getNth(i));
+      auto & same = seen[hash(gi)];
+      for (unsigned int k = 0; (k < same.size()) && unique[i]; k++) {
+        GAP* gj = get<1>(getNth(same[k]));
+        if (equiv(gi, gj)) {
+          unique[i] = false;
+        }
+      }
+      if (unique[i]) {
+        same.push_back(i);
+      }
+    }
+  }
+  else {
+    for (unsigned int i = 0; i < cSize; i++) {
+      GAP* gi = get<1>(getNth(i));
+      for (unsigned int j = 0; (j < i) && unique[i]; j++) {
+        GAP* gj = get<1>(getNth(j));
+        if (equiv(gi, gj)) {
+          unique[i] = false;
+        }
       }
     }
   }
-  auto newGP = vector<tuple<double, GAP*>>();
+  auto newVals = vector<double>();
+  auto newGenes = vector<GAP*>();
+  newVals.reserve(cSize);
+  newGenes.reserve(cSize);
   for (unsigned int i = 0; i < cSize; i++) {
-    auto pri = getNth(i);
     if (unique[i]) {
-      newGP.push_back(pri);
+      assert(nullptr != genes[i]);
+      newVals.push_back(vals[i]);
+      newGenes.push_back(genes[i]);
     }
     else {
-      get<0>(pri) = 0.0;
-      GAP* gi = get<1>(pri);
-      delete gi;
-      get<1>(pri) = nullptr;
+      retire(genes[i]);
     }
   }
-  gpool.clear();
-  while (0 < newGP.size()) {
-    auto pr = popBack(newGP);
-    assert(nullptr != get<1>(pr));
-    gpool.push_back(pr);
-  }
+  vals.swap(newVals); // keeping the order they had
+  genes.swap(newGenes);
   return;
 }
 
 template <class GAP>
 void GAOpt<GAP>::selectPop() {
   sortPop();
-  while (pSize < gpool.size()) {
-    auto pr = KBase::popBack(gpool);
-    GAP * g = get<1>(pr);
+  while (pSize < genes.size()) {
+    GAP * g = KBase::popBack(genes);
     assert(nullptr != g);
+    retire(g);
+  }
+  vals.resize(genes.size());
+  return;
+}
+
+
+template <class GAP>
+bool GAOpt<GAP>::recycleP() const {
+  return ((nullptr != mutateInto) && (nullptr != crossInto));
+}
+
+
+template <class GAP>
+void GAOpt<GAP>::retire(GAP* g) {
+  if (recycleP()) {
+    spares.push_back(g);
+  }
+  else {
     delete g;
   }
   return;
@@ -291,34 +409,77 @@ void GAOpt<GAP>::selectPop() {
 
 
 template <class GAP>
-void GAOpt<GAP>::cyclicApply(function <void(unsigned int i)> fn, double f) {
+double GAOpt<GAP>::evalGene(const GAP* g) {
+  if ((nullptr == cache) || (nullptr == hash)) {
+    return eval(g);
+  }
+  return cache->getOrEval(hash(g), [this, g]() { return eval(g); });
+}
+
+
+template <class GAP>
+void GAOpt<GAP>::cyclicApply(function <vector<tuple<double, GAP*>>(unsigned int i, PRNG* r,
+                                                                  const vector<GAP*> & kids)> fn,
+                              double f, unsigned int numKids) {
+  // Every call gets its gene and its own PRNG seed serially, from rng, and puts its
+  // results in its own slot. The slots are appended in call order, so the new pool
+  // does not depend on the number of threads or on how they were scheduled.
+  auto ndx = vector<unsigned int>();
   while (1 <= f) {
-    groupThreads(fn, 0, pSize-1, 0);
-    // for (unsigned int i = 0; i < pSize; i++) { fn(i); }
+    for (unsigned int i = 0; i < pSize; i++) {
+      ndx.push_back(i);
+    }
     f = f - 1.0;
   }
 
-  if (f <= 0.0) {
+  if (0.0 < f) { // now (0 < f < 1)
+    const unsigned int n = ((unsigned int)(0.5 + (f * pSize)));
+    for (unsigned int i = 0; i < n; i++) {
+      ndx.push_back(rng->uniform() % pSize); // 'existing' pool, not unevaluated additions
+    }
+  }
+
+  const unsigned int nc = ndx.size();
+  if (0 == nc) {
     return;
   }
+  auto seeds = vector<uint64_t>(nc);
+  for (unsigned int c = 0; c < nc; c++) {
+    const uint64_t s = rng->uniform();
+    seeds[c] = (0 == s) ? 1 : s; // zero would mean a nondeterministic seed
+  }
 
-  // now (0 < f < 1)
-  const unsigned int n = ((unsigned int)(0.5 + (f * pSize)));
+  // hand out the spares serially as well, so no thread touches the spare list
+  auto kids = vector<vector<GAP*>>(nc);
+  if (recycleP()) {
+    for (unsigned int c = 0; (c < nc) && (numKids <= spares.size()); c++) {
+      for (unsigned int k = 0; k < numKids; k++) {
+        kids[c].push_back(KBase::popBack(spares));
+      }
+    }
+  }
 
-  const function <void(unsigned int i)> gn = [this, fn] (unsigned int) {
-    unsigned int j = rng->uniform() % pSize; // 'existing' pool, not unevaluated additions
-    fn(j);
+  auto made = vector<vector<tuple<double, GAP*>>>(nc);
+  const function <void(unsigned int c)> gn = [fn, &ndx, &seeds, &kids, &made] (unsigned int c) {
+    PRNG rc(seeds[c]);
+    made[c] = fn(ndx[c], &rc, kids[c]);
     return;
   };
-
-  groupThreads(gn, 0, n-1, 0);
-  /*
-    for (unsigned int i = 0; i < n; i++) {
-        unsigned int j = rng->uniform() % pSize; // 'existing' pool, not unevaluated additions
-        fn(j);
+  if (1 == numPar) {
+    for (unsigned int c = 0; c < nc; c++) {
+      gn(c);
     }
-    */
+  }
+  else {
+    groupThreads(gn, 0, nc - 1, numPar);
+  }
 
+  for (auto & mc : made) {
+    for (auto & pr : mc) {
+      vals.push_back(get<0>(pr));
+      genes.push_back(get<1>(pr));
+    }
+  }
   return;
 }
 
@@ -327,59 +488,63 @@ template <class GAP>
 void GAOpt<GAP>::crossPop() {
 
   auto bundle = [this](GAP* g) {
-    double v = eval(g);
+    double v = evalGene(g);
     auto pr = tuple<double, GAP*>(v, g);
     return pr;
   };
 
-  auto cFn = [this, bundle](unsigned int i) {
+  auto cFn = [this, bundle](unsigned int i, PRNG* r, const vector<GAP*> & kids) {
     assert (i <pSize);
-    unsigned int j = rng->uniform() % pSize; // 'existing' pool, not unevaluated additions
-    GAP* gi = get<1>(getNth(i));
-    GAP* gj = get<1>(getNth(j));
-    auto pr = cross(gi, gj, rng);
-    auto pr0 = bundle(get<0>(pr));
-    auto pr1 = bundle(get<1>(pr));
-    cycAppMtx.lock();
-    const unsigned int s1 = gpool.size();
-    gpool.push_back(pr0);
-    gpool.push_back(pr1);
-    const unsigned int s2 = gpool.size();
-    assert (s2 == 2 + s1); // correct locking?
-    cycAppMtx.unlock();
-    return;
+    unsigned int j = r->uniform() % pSize; // 'existing' pool, not unevaluated additions
+    GAP* gi = genes[i];
+    GAP* gj = genes[j];
+    GAP* cA = nullptr;
+    GAP* cB = nullptr;
+    if (2 == kids.size()) {
+      cA = kids[0];
+      cB = kids[1];
+      crossInto(gi, gj, cA, cB, r);
+    }
+    else {
+      auto pr = cross(gi, gj, r);
+      cA = get<0>(pr);
+      cB = get<1>(pr);
+    }
+    auto pr0 = bundle(cA);
+    auto pr1 = bundle(cB);
+    return vector<tuple<double, GAP*>> { pr0, pr1 };
   };
 
-  cyclicApply(cFn, cFrac);
+  cyclicApply(cFn, cFrac, 2);
   return;
 }
 
 
 template <class GAP>
 void GAOpt<GAP>::mutatePop() {
-  auto mFn = [this](unsigned int i) {
-    GAP* gi = get<1>(getNth(i));
-    GAP* mg = mutate(gi, rng);
-    double mgv = eval(mg);
+  auto mFn = [this](unsigned int i, PRNG* r, const vector<GAP*> & kids) {
+    GAP* gi = genes[i];
+    GAP* mg = nullptr;
+    if (1 == kids.size()) {
+      mg = kids[0];
+      mutateInto(gi, mg, r);
+    }
+    else {
+      mg = mutate(gi, r);
+    }
+    double mgv = evalGene(mg);
     auto mpr = tuple<double, GAP*>(mgv, mg);
-    cycAppMtx.lock();
-    const unsigned int s1 = gpool.size();
-    gpool.push_back(mpr);
-    const unsigned int s2 = gpool.size();
-    assert (s2 == 1 + s1);
-    cycAppMtx.unlock();
-    return;
+    return vector<tuple<double, GAP*>> { mpr };
   };
-  cyclicApply(mFn, mFrac);
+  cyclicApply(mFn, mFrac, 1);
   return;
 }
 
 template <class GAP>
 void GAOpt<GAP>::show() {
-  for (unsigned int i = 0; i < gpool.size(); i++) {
-    auto pri = gpool[i];
-    auto vi = get<0>(pri);
-    auto gi = get<1>(pri);
+  for (unsigned int i = 0; i < genes.size(); i++) {
+    auto vi = vals[i];
+    auto gi = genes[i];
     LOG(INFO) << getFormattedString("%4u  %8.3f", i, vi);
     assert(nullptr != gi);
     showGene(gi);
@@ -389,13 +554,13 @@ void GAOpt<GAP>::show() {
 
 template <class GAP>
 void GAOpt<GAP>::step() {
-  assert(pSize == gpool.size());
+  assert(pSize == genes.size());
   mutatePop();
   crossPop();
   dropDups();
-  assert(pSize <= gpool.size());
+  assert(pSize <= genes.size());
   selectPop();
-  assert(pSize == gpool.size());
+  assert(pSize == genes.size());
   return;
 }
 
@@ -406,13 +571,11 @@ void GAOpt<GAP>::fill(PRNG* r) {
   assert(makeGene != nullptr);
   assert(nullptr != r);
   rng = r;
-  //const unsigned int ps = gpool.size();
-  for (unsigned int i = 0; i < gpool.size(); i++) {
-    auto pri = gpool[i];
-    if (nullptr == get<1>(pri)) {
+  for (unsigned int i = 0; i < genes.size(); i++) {
+    if (nullptr == genes[i]) {
       GAP* gi = makeGene(rng);
-      double vi = eval(gi);
-      gpool[i] = tuple<double, GAP*>(vi, gi);
+      vals[i] = evalGene(gi);
+      genes[i] = gi;
     }
   }
   return;
@@ -424,19 +587,181 @@ void GAOpt<GAP>::init(vector < GAP* > ipop) {
   assert(eval != nullptr);
   assert(ipop.size() <= pSize);
   for (unsigned int i = 0; i < ipop.size(); i++) {
-    auto pri = getNth(i);
-    auto tgi = get<1>(pri);
-    assert(nullptr == tgi);
+    assert(nullptr == genes[i]);
     auto gi = ipop[i];
     assert(nullptr != gi);
-    double vi = eval(gi);
-    auto pvi = tuple<double, GAP*>(vi, gi);
-    gpool[i] = pvi;
+    vals[i] = evalGene(gi);
+    genes[i] = gi;
   }
   return;
 }
 
 
+
+// -------------------------------------------------
+
+template <class GAP>
+GAIslands<GAP>::GAIslands(unsigned int numIsl, unsigned int islSize) {
+  assert(1 < numIsl); // else, just use GAOpt
+  for (unsigned int k = 0; k < numIsl; k++) {
+    isles.push_back(new GAOpt<GAP>(islSize));
+    rngs.push_back(new PRNG());
+  }
+}
+
+
+template <class GAP>
+GAIslands<GAP>::~GAIslands() {
+  for (auto isl : isles) {
+    delete isl;
+  }
+  for (auto r : rngs) {
+    delete r;
+  }
+}
+
+
+template <class GAP>
+unsigned int GAIslands<GAP>::numIslands() const {
+  return isles.size();
+}
+
+
+template <class GAP>
+GAOpt<GAP>* GAIslands<GAP>::getIsland(unsigned int k) const {
+  assert(k < isles.size());
+  return isles[k];
+}
+
+
+template <class GAP>
+void GAIslands<GAP>::fill(PRNG* rng) {
+  assert(nullptr != rng);
+  assert(makeGene != nullptr);
+  for (unsigned int k = 0; k < isles.size(); k++) {
+    const uint64_t s = rng->uniform();
+    rngs[k]->setSeed((0 == s) ? 1 : s); // zero would mean a nondeterministic seed
+
+    auto isl = isles[k];
+    isl->cross = cross;
+    isl->mutate = mutate;
+    isl->eval = eval;
+    isl->showGene = showGene;
+    isl->makeGene = makeGene;
+    isl->equiv = equiv;
+    isl->hash = hash;
+    isl->cache = cache;
+    isl->mutateInto = mutateInto;
+    isl->crossInto = crossInto;
+    isl->numPar = 1; // the islands are the parallel units
+    isl->fill(rngs[k]);
+    isl->sortPop();
+  }
+  return;
+}
+
+
+template <class GAP>
+tuple<double, GAP* > GAIslands<GAP>::getBest() const {
+  auto best = isles[0]->getNth(0);
+  for (unsigned int k = 1; k < isles.size(); k++) {
+    auto bk = isles[k]->getNth(0);
+    if (get<0>(bk) > get<0>(best)) { // ties go to the lower island
+      best = bk;
+    }
+  }
+  return best;
+}
+
+
+template <class GAP>
+void GAIslands<GAP>::migrate(unsigned int numMigr) {
+  const unsigned int ni = isles.size();
+  // copy all the emigrants before any island changes
+  auto migrants = vector<vector<tuple<double, GAP*>>>(ni);
+  for (unsigned int k = 0; k < ni; k++) {
+    for (unsigned int m = 0; m < numMigr; m++) {
+      auto pr = isles[k]->getNth(m);
+      migrants[k].push_back(tuple<double, GAP*>(get<0>(pr), new GAP(*get<1>(pr))));
+    }
+  }
+  for (unsigned int k = 0; k < ni; k++) {
+    auto dest = isles[(k + 1) % ni];
+    for (auto & pr : migrants[k]) {
+      dest->retire(KBase::popBack(dest->genes));
+      dest->vals.pop_back();
+      dest->vals.push_back(get<0>(pr));
+      dest->genes.push_back(get<1>(pr));
+    }
+    dest->sortPop();
+  }
+  return;
+}
+
+
+template <class GAP>
+void GAIslands<GAP>::run(double c, double m, unsigned int epochLen, unsigned int numMigr,
+                         unsigned int maxI, double sTh, unsigned int maxS,
+                         ReportingLevel srl,
+                         unsigned int & iter, unsigned int & sIter) {
+  assert(cross != nullptr);
+  assert(mutate != nullptr);
+  assert(eval != nullptr);
+  assert(showGene != nullptr);
+  assert(equiv != nullptr);
+  assert((0 <= c) && (0 <= m) && (0 < c + m));
+  assert(0 < epochLen);
+  assert(numMigr < isles[0]->pSize);
+  assert(0 < maxS);
+  assert(0 < sTh);
+  assert(maxS < maxI);
+  iter = 0;
+  sIter = 0;
+
+  for (auto isl : isles) {
+    isl->cFrac = c;
+    isl->mFrac = m;
+  }
+
+  auto epochFn = [this, epochLen](unsigned int k) {
+    for (unsigned int g = 0; g < epochLen; g++) {
+      isles[k]->step();
+    }
+    return;
+  };
+
+  bool runP = true;
+  while (runP) {
+    const double oldBest = get<0>(getBest());
+    groupThreads(epochFn, 0, isles.size() - 1, numPar);
+    migrate(numMigr);
+    auto pri = getBest();
+    const double newBest = get<0>(pri);
+    const double dv = newBest - oldBest;
+    assert(0.0 <= dv);
+
+    iter = iter + epochLen;
+    sIter = (sTh < dv) ? 0 : sIter + epochLen;
+    runP = (iter < maxI) && (sIter < maxS);
+
+    if (ReportingLevel::Low < srl) {
+      LOG(INFO) << getFormattedString("%u/%u generations and %u/%u stable", iter, maxI, sIter, maxS);
+      LOG(INFO) << getFormattedString("newBest value: %+.4f up %+.4f", newBest, dv);
+      LOG(INFO) << "newBest gene:";
+      showGene(get<1>(pri));
+    }
+  }
+  if (ReportingLevel::Silent < srl) {
+    auto pri = getBest();
+    LOG(INFO) << getFormattedString("Island search of %u islands completed after %u/%u generations and %u/%u stable",
+                                    numIslands(), iter, maxI, sIter, maxS);
+    LOG(INFO) << getFormattedString("best value: %+.4f", get<0>(pri));
+    LOG(INFO) << "best gene: ";
+    showGene(get<1>(pri));
+  }
+  return;
+}
+
 }; // namespace
 
 // -------------------------------------------------
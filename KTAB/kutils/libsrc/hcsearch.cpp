@@ -78,15 +78,158 @@ VHCSearch::~VHCSearch() {
   // nothing yet
 }
 
+// evaluate each point, through the cache if there is one, in its own slot
+vector<double> VHCSearch::evalAll(const vector<KMatrix> & ps, unsigned int nPar) {
+  const unsigned int n = ps.size();
+  auto vs = vector<double>(n, 0.0);
+  const bool memoP = ((nullptr != cache) && (nullptr != hash));
+  if (0 == n) {
+    return vs;
+  }
+
+  if (nullptr != evalBatch) {
+    // look everything up first, then evaluate only the misses, in one batch
+    auto keys = vector<uint64_t>(n, 0);
+    auto missNdx = vector<unsigned int>();
+    auto missPs = vector<KMatrix>();
+    for (unsigned int i = 0; i < n; i++) {
+      if (memoP) {
+        keys[i] = hash(ps[i]);
+        if (cache->find(keys[i], vs[i])) {
+          continue;
+        }
+      }
+      missNdx.push_back(i);
+      missPs.push_back(ps[i]);
+    }
+    if (0 < missPs.size()) {
+      const auto mvs = evalBatch(missPs);
+      if (mvs.size() != missPs.size()) {
+        throw KException("VHCSearch::evalAll: evalBatch must return one value per point");
+      }
+      for (unsigned int k = 0; k < missNdx.size(); k++) {
+        vs[missNdx[k]] = mvs[k];
+        if (memoP) {
+          cache->insert(keys[missNdx[k]], mvs[k]);
+        }
+      }
+    }
+    return vs;
+  }
+
+  auto evalC = [this, memoP](const KMatrix & p) {
+    if (!memoP) {
+      return eval(p);
+    }
+    return cache->getOrEval(hash(p), [this, &p]() { return eval(p); });
+  };
+
+  if (1 == nPar) {
+    for (unsigned int i = 0; i < n; i++) {
+      vs[i] = evalC(ps[i]);
+    }
+    return vs;
+  }
+
+  auto errs = vector<string>(n, "");
+  auto evalN = [&evalC, &ps, &vs, &errs](unsigned int i) {
+    try {
+      vs[i] = evalC(ps[i]);
+    }
+    catch (KException &ke) {
+      errs[i] = ke.msg;
+    }
+    catch (std::exception &std_ex) {
+      errs[i] = std_ex.what();
+    }
+    return;
+  };
+  groupThreads(evalN, 0, n - 1, nPar);
+  for (auto & e : errs) {
+    if (0 < e.length()) {
+      throw KException(e);
+    }
+  }
+  return vs;
+}
+
+
 tuple<double, KMatrix, unsigned int, unsigned int>
 VHCSearch::run(KMatrix p0,
                unsigned int iMax, unsigned int sMax, double sTol,
                double s0, double shrink, double grow, double minStep,
                ReportingLevel rl) {
-  using std::thread;
+  return runFrom(p0, iMax, sMax, sTol, s0, shrink, grow, minStep, rl, numPar);
+}
+
 
-  if (eval == nullptr) {
-    throw KException("VHCSearch::run: eval is a null pointer");
+tuple<unsigned int, vector<tuple<double, KMatrix, unsigned int, unsigned int>>>
+VHCSearch::runMulti(const vector<KMatrix> & starts,
+                    unsigned int iMax, unsigned int sMax, double sTol,
+                    double s0, double shrink, double grow, double minStep,
+                    ReportingLevel rl) {
+  const unsigned int numS = starts.size();
+  if (0 == numS) {
+    throw KException("VHCSearch::runMulti: there must be at least one starting point");
+  }
+  using VHCResult = tuple<double, KMatrix, unsigned int, unsigned int>;
+  auto rslts = vector<VHCResult>(numS);
+
+  if ((1 == numS) || (1 == numPar)) {
+    for (unsigned int k = 0; k < numS; k++) {
+      rslts[k] = runFrom(starts[k], iMax, sMax, sTol, s0, shrink, grow, minStep, rl, numPar);
+    }
+  }
+  else {
+    // concurrent searches would only interleave their reports, so they are silent
+    auto errs = vector<string>(numS, "");
+    auto runK = [&](unsigned int k) {
+      try {
+        rslts[k] = runFrom(starts[k], iMax, sMax, sTol, s0, shrink, grow, minStep,
+                           ReportingLevel::Silent, 1);
+      }
+      catch (KException &ke) {
+        errs[k] = ke.msg;
+      }
+      catch (std::exception &std_ex) {
+        errs[k] = std_ex.what();
+      }
+      return;
+    };
+    groupThreads(runK, 0, numS - 1, numPar);
+    for (auto & e : errs) {
+      if (0 < e.length()) {
+        throw KException(e);
+      }
+    }
+  }
+
+  unsigned int kBest = 0;
+  for (unsigned int k = 1; k < numS; k++) {
+    if (get<0>(rslts[k]) > get<0>(rslts[kBest])) {
+      kBest = k;
+    }
+  }
+
+  if (ReportingLevel::Low <= rl) {
+    for (unsigned int k = 0; k < numS; k++) {
+      LOG(INFO) << getFormattedString("Start %u: value %+.6f after %u iterations, %u stable",
+                                      k, get<0>(rslts[k]), get<2>(rslts[k]), get<3>(rslts[k]));
+    }
+    LOG(INFO) << getFormattedString("Best of %u starts was %u, with value %+.6f",
+                                    numS, kBest, get<0>(rslts[kBest]));
+  }
+  return tuple<unsigned int, vector<VHCResult>>(kBest, rslts);
+}
+
+
+tuple<double, KMatrix, unsigned int, unsigned int>
+VHCSearch::runFrom(KMatrix p0,
+                   unsigned int iMax, unsigned int sMax, double sTol,
+                   double s0, double shrink, double grow, double minStep,
+                   ReportingLevel rl, unsigned int nPar) {
+  if ((eval == nullptr) && (evalBatch == nullptr)) {
+    throw KException("VHCSearch::run: eval and evalBatch are both null pointers");
   }
   if (nghbrs == nullptr) {
     throw KException("VHCSearch::run: nghbrs is a null pointer");
@@ -94,13 +237,9 @@ VHCSearch::run(KMatrix p0,
   unsigned int iter = 0;
   unsigned int sIter = 0;
   double currStep = s0;
-  double v0 = eval(p0);
-  const double vInitial = v0;
 
-  // set the variables in this objects
-  vhcBestVal = v0;
-  vhcBestPoint = p0;
-  const bool parP = true;
+  double v0 = evalAll(vector<KMatrix> { p0 }, 1)[0];
+  const double vInitial = v0;
 
   auto showFn = [this](string preface, const KMatrix & p, double v) {
     LOG(INFO) << preface << "point:";
@@ -121,61 +260,29 @@ VHCSearch::run(KMatrix p0,
       throw KException("VHCSearch::run: either stay at orig point or improve it");
     }
 
-
-    // TODO: change this to use groupThreads
-    auto ts = vector<thread>();
     const auto nPnts = nghbrs(p0, currStep);
-    const unsigned int numPnts = nPnts.size();
-    for (unsigned int i = 0; i < numPnts; i++) {
-      auto pTmp = nPnts[i];
-      if (parP) {
-        ts.push_back(thread([pTmp, i, this]() {
-          // Notice that 'eval' is not in the critical section, so we could
-          // have arbitrarily many 'eval' operations running concurrently,
-          // interleaved arbitrarily with test&reset in the critical section.
-          // So we may eval(p1), eval(p2), test(val2), eval(p3), test(val3), test(val1)
-          // and it will still correctly get the best of three values, and
-          // the matching point.
-          double vTmp = eval(pTmp);
-          vhcEvalMtx.lock();
-          if (vTmp > vhcBestVal) {
-            vhcBestVal = vTmp;
-            vhcBestPoint = pTmp;
-          }
-          vhcEvalMtx.unlock();
-          return;
-        }));
-      }
-      else {
-        // sequential execution, so no need for mutex.
-        double vTmp = eval(pTmp);
-        if (vTmp > vhcBestVal) {
-          vhcBestVal = vTmp;
-          vhcBestPoint = pTmp;
-        }
-      }
-    }
+    const auto nVals = evalAll(nPnts, nPar);
 
-    if (parP) {
-      for (unsigned int i = 0; i < ts.size(); i++) {
-        auto& t = ts[i];
-        t.join();
+    // strictly greater, so ties go to the earlier neighbor
+    double vBest = v0;
+    unsigned int iBest = nPnts.size();
+    for (unsigned int i = 0; i < nPnts.size(); i++) {
+      if (nVals[i] > vBest) {
+        vBest = nVals[i];
+        iBest = i;
       }
     }
 
-    // lock is necessary if multi-threaded, harmless if single-threaded
-    vhcEvalMtx.lock();
-    if (vhcBestVal > v0 + sTol) {
+    if (vBest > v0 + sTol) {
       sIter = 0;
       currStep = grow*currStep;
-      v0 = vhcBestVal;
-      p0 = vhcBestPoint;
+      v0 = vBest;
+      p0 = nPnts[iBest];
     }
     else {
       sIter++;
       currStep = shrink*currStep;
     }
-    vhcEvalMtx.unlock();
 
     if (vInitial > v0) {
       throw KException("VHCSearch::run: either stay at orig point or improve it");
@@ -185,7 +292,7 @@ VHCSearch::run(KMatrix p0,
 
 
     if (ReportingLevel::Medium <= rl) {
-      if (parP) {
+      if (1 != nPar) {
         LOG(INFO) << "After multi-threaded VHC iteration" << iter;
       }
       else {
@@ -205,6 +312,11 @@ VHCSearch::run(KMatrix p0,
 
   if (ReportingLevel::Low <= rl) {
     showFn("Final", p0, v0);
+    if ((nullptr != cache) && (nullptr != hash)) {
+      LOG(INFO) << getFormattedString("Eval cache hit rate %.3f (%llu hits, %llu misses)",
+                                      cache->hitRate(), (unsigned long long)cache->hits(),
+                                      (unsigned long long)cache->misses());
+    }
   }
   return rslt;
 }
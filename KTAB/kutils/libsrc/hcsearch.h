@@ -26,12 +26,15 @@
 #define KBASE_HCSEARCH_H
 
 #include <functional>   // function
+#include <limits>
+#include <thread>
 #include <tuple>        // tuple, get, etc.
 #include <vector>
 #include <easylogging++.h>
 
 #include "kutils.h"
 #include "kmatrix.h"
+#include "evalcache.h"
 
 
 // ----------------------------------------------
@@ -63,6 +66,16 @@ public:
       ReportingLevel rl
       );
 
+  // Run from each starting point, up to numPar starts at a time, each of which
+  // then evaluates its neighbors serially. Returns the index of the best start
+  // (ties go to the earlier one) and each start's result, as from run().
+  tuple<unsigned int, vector<tuple<double, KMatrix, unsigned int, unsigned int>>>
+  runMulti(const vector<KMatrix> & starts,
+           unsigned int iMax, unsigned int sMax, double sTol,
+           double s0, double shrink, double grow, double minStep,
+           ReportingLevel rl
+           );
+
   static vector<KMatrix> vn1(const KMatrix & m0, double s);
   static vector<KMatrix> vn2(const KMatrix & m0, double s);
 
@@ -70,19 +83,42 @@ public:
   function < vector<KMatrix>(const KMatrix &, double)> nghbrs = nullptr;
   function <void(const KMatrix &)> report = nullptr;
 
-protected:
+  // Optional: evaluates a whole neighborhood in one call, e.g. to vectorize
+  // across the points, returning one value per point in the same order.
+  // When set, it is used instead of eval, which may then be null.
+  function <vector<double>(const vector<KMatrix> &)> evalBatch = nullptr;
 
-  // Note that these variables to control the search are
-  // unique to this object, so it should be OK to run
-  // several VHCSearch objects concurrently.
-  std::mutex vhcEvalMtx;
-  double vhcBestVal = 0.0;
-  KMatrix vhcBestPoint = KMatrix();
+  // Neighbors are evaluated up to numPar at a time, as for groupThreads, so
+  // 'eval' must be thread-safe unless numPar is 1. Ties always go to the
+  // neighbor listed first by nghbrs, so the search does not depend on numPar.
+  unsigned int numPar = 0;
+
+  // Optional memo of eval, used when both are set, e.g. with
+  // hash = [](const KMatrix & m) { return EvalCache::hash(m, 1E-9); };
+  // The cache is not owned, and must only ever see this eval.
+  function <uint64_t(const KMatrix &)> hash = nullptr;
+  EvalCache * cache = nullptr;
+
+protected:
+  // The state of a search is all local to runFrom, so it is safe to run
+  // several searches concurrently, even on the same VHCSearch object.
+  tuple<double, KMatrix, unsigned int, unsigned int>
+  runFrom(KMatrix p0,
+          unsigned int iMax, unsigned int sMax, double sTol,
+          double s0, double shrink, double grow, double minStep,
+          ReportingLevel rl, unsigned int nPar);
+  vector<double> evalAll(const vector<KMatrix> & ps, unsigned int nPar);
 
 private:
 };
 
 
+// How GHCSearch moves from a point to one of its neighbors
+enum class HCMove : uint8_t {
+  BestImprovement = 0, // evaluate the whole neighborhood, move to its best point
+  FirstImprovement     // move to the first neighbor, in nghbrs order, better by more than sTol
+};
+
 // Class to setup maximization of scalar function of arbitrary class
 template <class HCP>
 class GHCSearch {
@@ -98,6 +134,24 @@ public:
   function <vector<HCP>(const HCP)> nghbrs = nullptr;
   function <void(const HCP)> show = nullptr;
 
+  // Neighbors are evaluated up to numPar at a time: 1 evaluates them serially
+  // in the calling thread, 0 lets groupThreads decide. So 'eval' must be
+  // thread-safe unless numPar is 1. The path of the search does not depend
+  // on numPar, as ties always go to the neighbor listed first by nghbrs.
+  unsigned int numPar = 1;
+  HCMove move = HCMove::BestImprovement;
+
+  // Stop early once a point is worth at least vStop, or once maxEvals
+  // neighbors have been evaluated (0 for no limit).
+  double vStop = std::numeric_limits<double>::infinity();
+  unsigned int maxEvals = 0;
+
+  // Optional memo of eval, used when both are set. The cache is not owned,
+  // and must only ever see this eval. Hits still count toward maxEvals,
+  // so the search path is the same with or without a cache.
+  function <uint64_t(const HCP)> hash = nullptr;
+  EvalCache * cache = nullptr;
+
 protected:
 
 private:
@@ -122,46 +176,95 @@ tuple<double, HCP, unsigned int, unsigned int>
 GHCSearch<HCP>::run(HCP p0, ReportingLevel srl,
                     unsigned int iMax, unsigned int sMax, double sTol) {
 
-
-  // Note that these variables to control the search are
-  // unique to this object, so it should be OK to run
-  // several GHCSearch objects concurrently.
-  std::mutex ghcEvalMtx;
-
   assert(eval != nullptr);
   assert(nghbrs != nullptr);
   unsigned int iter = 0;
   unsigned int sIter = 0;
-  double v0 = eval(p0);
-
+  unsigned int numEvals = 0;
 
-  // TODO: change this to use groupThreads
-  // Currently, it is actually single-threaded (with a mutex).
+  auto evalC = [this](const HCP & p) {
+    if ((nullptr == cache) || (nullptr == hash)) {
+      return eval(p);
+    }
+    return cache->getOrEval(hash(p), [this, &p]() { return eval(p); });
+  };
+  double v0 = evalC(p0);
+
+  // Without early exits, each neighborhood is evaluated as one batch. With them,
+  // a batch is one group of threads, and each batch is scanned in nghbrs order,
+  // so the search stops at the same neighbor as a serial search would.
+  const bool earlyP = (HCMove::FirstImprovement == move) || (0 < maxEvals) ||
+                      (vStop < std::numeric_limits<double>::infinity());
+  unsigned int batchSize = numPar;
+  if (0 == batchSize) {
+    batchSize = getMaxThreads();
+  }
+  if (0 == batchSize) {
+    batchSize = std::thread::hardware_concurrency();
+  }
+  if (0 == batchSize) {
+    batchSize = 1;
+  }
 
-  while ((iter < iMax) && (sIter < sMax)) {
+  bool stopP = (vStop <= v0);
+  while ((iter < iMax) && (sIter < sMax) && !stopP) {
     double dv = 0;
     double vBest = v0;
     HCP pBest = p0;
 
-    for (HCP pTmp : nghbrs(p0)) {
-
-      // Notice that 'eval' is not in the critical section, so we could
-      // have arbitrarily many 'eval' operations running concurrently,
-      // interleaved arbitrarily with test&reset in the critical section.
-      // So we may eval(p1), eval(p2), test(val2), eval(p3), test(val3), test(val1)
-      // and it will still correctly get the best of three values, and
-      // the matching point.
-      double vTmp = eval(pTmp);
-      ghcEvalMtx.lock();
-      if (vTmp > vBest) {
-        vBest = vTmp;
-        pBest = pTmp;
+    const vector<HCP> ns = nghbrs(p0);
+    unsigned int numN = ns.size();
+    if ((0 < maxEvals) && (maxEvals - numEvals < numN)) {
+      numN = maxEvals - numEvals;
+    }
+
+    // each neighbor's value, or error, goes in its own slot
+    auto vs = vector<double>(numN, 0.0);
+    auto errs = vector<string>(numN, "");
+    auto evalN = [&evalC, &ns, &vs, &errs](unsigned int n) {
+      try {
+        vs[n] = evalC(ns[n]);
+      }
+      catch (KException &ke) {
+        errs[n] = ke.msg;
+      }
+      catch (std::exception &std_ex) {
+        errs[n] = std_ex.what();
+      }
+      return;
+    };
+
+    bool doneP = false;
+    unsigned int n0 = 0;
+    while ((n0 < numN) && !doneP) {
+      const unsigned int n1 = (earlyP && (n0 + batchSize < numN)) ? n0 + batchSize : numN;
+      if (1 == numPar) {
+        for (unsigned int n = n0; n < n1; n++) {
+          vs[n] = evalC(ns[n]);
+        }
+      }
+      else {
+        groupThreads(evalN, n0, n1 - 1, numPar);
+        for (unsigned int n = n0; n < n1; n++) {
+          if (0 < errs[n].length()) {
+            throw KException(errs[n]);
+          }
+        }
+      }
+
+      // strictly greater, so ties go to the earlier neighbor
+      for (unsigned int n = n0; (n < n1) && !doneP; n++) {
+        numEvals++;
+        if (vs[n] > vBest) {
+          vBest = vs[n];
+          pBest = ns[n];
+        }
+        doneP = (vStop <= vBest) ||
+                ((HCMove::FirstImprovement == move) && (vBest > v0 + sTol));
       }
-      ghcEvalMtx.unlock();
+      n0 = n1;
     }
 
-    // lock is necessary if multi-threaded, harmless if single-threaded
-    ghcEvalMtx.lock();
     if (vBest > v0 + sTol) {
       sIter = 0;
       dv = vBest - v0;
@@ -171,8 +274,8 @@ GHCSearch<HCP>::run(HCP p0, ReportingLevel srl,
     else {
       sIter++;
     }
-    ghcEvalMtx.unlock();
     iter++;
+    stopP = (vStop <= v0) || ((0 < maxEvals) && (maxEvals <= numEvals));
 
     if (ReportingLevel::Low < srl) {
       LOG(INFO) << KBase::getFormattedString("%u/%u iterations    %u/%u stable", iter, iMax, sIter, sMax);
@@ -185,6 +288,14 @@ GHCSearch<HCP>::run(HCP p0, ReportingLevel srl,
     LOG(INFO) << KBase::getFormattedString(
       "GHCSearch::run ended with %u/%u iterations    %u/%u stable", iter,
       iMax, sIter, sMax);
+    if (stopP) {
+      LOG(INFO) << KBase::getFormattedString("Stopped early after %u evaluations", numEvals);
+    }
+    if ((nullptr != cache) && (nullptr != hash)) {
+      LOG(INFO) << KBase::getFormattedString("Eval cache hit rate %.3f (%llu hits, %llu misses)",
+                                             cache->hitRate(), (unsigned long long)cache->hits(),
+                                             (unsigned long long)cache->misses());
+    }
     LOG(INFO) << KBase::getFormattedString("newBest value: %+.4f", v0);
     LOG(INFO) << "newBest point:";
     show(p0);
@@ -0,0 +1,233 @@
+﻿// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 King Abdullah Petroleum Studies and Research Center
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+// --------------------------------------------
+// Asynchronous logging facade: a bounded lock-free queue drained to
+// easylogging++ by one background thread.
+// --------------------------------------------
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <easylogging++.h>
+
+#include "klog.h"
+
+namespace KBase {
+
+std::atomic<bool> KLog::infoOn(true);
+
+namespace {
+
+// Bounded multi-producer queue in the style of D. Vyukov: each cell carries a
+// sequence number telling producers and the consumer whose turn it is.
+class KLogQueue {
+public:
+  explicit KLogQueue(size_t cap) : mask(cap - 1), cells(new Cell[cap]) {
+    for (size_t n = 0; n < cap; n++) {
+      cells[n].seq.store(n, std::memory_order_relaxed);
+    }
+  }
+
+  // moves from e only on success
+  bool tryPush(KLogEvent & e) {
+    size_t pos = enqPos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell & c = cells[pos & mask];
+      const size_t seq = c.seq.load(std::memory_order_acquire);
+      const intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+      if (0 == dif) {
+        if (enqPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          c.ev = std::move(e);
+          c.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (dif < 0) {
+        return false; // full
+      }
+      else {
+        pos = enqPos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool tryPop(KLogEvent & e) {
+    size_t pos = deqPos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell & c = cells[pos & mask];
+      const size_t seq = c.seq.load(std::memory_order_acquire);
+      const intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (0 == dif) {
+        if (deqPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          e = std::move(c.ev);
+          c.seq.store(pos + mask + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if (dif < 0) {
+        return false; // empty
+      }
+      else {
+        pos = deqPos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    KLogEvent ev;
+  };
+  const size_t mask;
+  std::unique_ptr<Cell[]> cells;
+  std::atomic<size_t> enqPos{ 0 };
+  std::atomic<size_t> deqPos{ 0 };
+};
+
+class KLogDrain {
+public:
+  KLogDrain() : q(4096) {
+    thr = std::thread(&KLogDrain::drainLoop, this);
+  }
+
+  ~KLogDrain() {
+    stopP.store(true);
+    wake.notify_one();
+    thr.join();
+  }
+
+  void push(KLogEvent && e) {
+    // back-pressure rather than dropping lines when the writer falls behind
+    while (!q.tryPush(e)) {
+      wake.notify_one();
+      std::this_thread::yield();
+    }
+    pushed.fetch_add(1, std::memory_order_release);
+    if (sleeping.load(std::memory_order_acquire)) {
+      wake.notify_one();
+    }
+  }
+
+  void flush() {
+    const uint64_t target = pushed.load(std::memory_order_acquire);
+    wake.notify_one();
+    std::unique_lock<std::mutex> lk(mtx);
+    while (written.load(std::memory_order_acquire) < target) {
+      done.wait_for(lk, std::chrono::milliseconds(5));
+    }
+  }
+
+private:
+  static void write(const KLogEvent & e) {
+    const string s = (nullptr != e.fmt) ? e.fmt(e) : e.text;
+    size_t start = 0;
+    while (true) {
+      const size_t nl = s.find('\n', start);
+      if (string::npos == nl) {
+        LOG(INFO) << s.substr(start);
+        return;
+      }
+      LOG(INFO) << s.substr(start, nl - start);
+      start = nl + 1;
+    }
+  }
+
+  void drainLoop() {
+    KLogEvent e;
+    while (true) {
+      bool any = false;
+      while (q.tryPop(e)) {
+        write(e);
+        written.fetch_add(1, std::memory_order_release);
+        any = true;
+      }
+      if (any) {
+        std::lock_guard<std::mutex> lk(mtx);
+        done.notify_all();
+      }
+      if (stopP.load() && (written.load() >= pushed.load())) {
+        return;
+      }
+      std::unique_lock<std::mutex> lk(mtx);
+      sleeping.store(true, std::memory_order_release);
+      // the timeout covers a push that raced with going to sleep
+      wake.wait_for(lk, std::chrono::milliseconds(10));
+      sleeping.store(false, std::memory_order_release);
+    }
+  }
+
+  KLogQueue q;
+  std::thread thr;
+  std::mutex mtx;
+  std::condition_variable wake;
+  std::condition_variable done;
+  std::atomic<bool> stopP{ false };
+  std::atomic<bool> sleeping{ false };
+  std::atomic<uint64_t> pushed{ 0 };
+  std::atomic<uint64_t> written{ 0 };
+};
+
+// Constructed on first use, i.e. after the logger's own globals, so it is
+// destroyed (and drained) before them.
+KLogDrain & drain() {
+  static KLogDrain d;
+  return d;
+}
+
+} // end of anonymous namespace
+
+
+void KLog::refresh() {
+  const el::Logger * lg = el::Loggers::getLogger("default", false);
+  infoOn.store((nullptr != lg) && lg->enabled(el::Level::Info));
+}
+
+void KLog::setEnabled(bool on) {
+  infoOn.store(on);
+}
+
+void KLog::post(KLogEvent && e) {
+  if (!enabled()) {
+    return;
+  }
+  drain().push(std::move(e));
+}
+
+void KLog::post(string && text) {
+  if (!enabled()) {
+    return;
+  }
+  KLogEvent e;
+  e.text = std::move(text);
+  drain().push(std::move(e));
+}
+
+void KLog::flush() {
+  drain().flush();
+}
+
+} // end of namespace
+
+// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
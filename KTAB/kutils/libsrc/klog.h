@@ -0,0 +1,86 @@
+﻿// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 King Abdullah Petroleum Studies and Research Center
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+// -------------------------------------------------
+// A small asynchronous logging facade for hot paths.
+//
+// Callers test KLog::enabled() before formatting anything, so disabling
+// INFO in easylogging++ makes a log point cost one relaxed atomic load.
+// Enabled entries go into a bounded lock-free queue, and a background
+// thread writes them to easylogging++. An entry is either a structured
+// event, formatted only on the background thread, or a block of
+// preformatted text whose lines are kept together.
+// -------------------------------------------------
+#ifndef KBASE_KLOG_H
+#define KBASE_KLOG_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace KBase {
+
+using std::string;
+
+struct KLogEvent;
+typedef string(*KLogFormatter)(const KLogEvent & e);
+
+// a structured log event; fmt turns it into (possibly multi-line) text
+struct KLogEvent {
+  KLogFormatter fmt = nullptr;
+  int turn = 0;
+  unsigned int n[4] = { 0, 0, 0, 0 };
+  double x[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+  string text = string(); // used as-is when fmt is null
+};
+
+class KLog {
+public:
+  // cheap check, to be made before any formatting
+  static bool enabled() {
+    return infoOn.load(std::memory_order_relaxed);
+  }
+
+  // re-read whether easylogging++ has INFO enabled. Call after reconfiguring loggers.
+  static void refresh();
+
+  // override the easylogging++ setting, e.g. for a silent batch run
+  static void setEnabled(bool on);
+
+  // queue a structured event or a block of text.
+  // Both are no-ops when logging is disabled.
+  static void post(KLogEvent && e);
+  static void post(string && text);
+
+  // block until everything queued so far has been written
+  static void flush();
+
+private:
+  static std::atomic<bool> infoOn;
+};
+
+} // end of namespace
+
+// -------------------------------------------------
+#endif
+// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
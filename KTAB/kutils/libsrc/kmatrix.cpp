@@ -26,6 +26,8 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <algorithm>
+#include <limits>
 #include <vector>
 
 #include "prng.h"
@@ -35,6 +37,8 @@
 
 namespace KBase {
 
+using std::get;
+
 KMatrix subMatrix(const KMatrix & m1,
                   unsigned int i1, unsigned int i2,
                   unsigned int j1, unsigned int j2) {
@@ -454,11 +458,17 @@ void KMatrix::mapV(function<void(unsigned int i, unsigned int j)> f, unsigned in
 }
 
 
+// Filled in storage order, which is row-by-row, just as map would
 KMatrix KMatrix::uniform(PRNG* rng, unsigned int nr, unsigned int nc, double a, double b) {
-    auto rf = [rng, a, b](unsigned int, unsigned int) {
-        return rng->uniform(a, b);
-    };
-    return map(rf, nr, nc);
+    auto m = KMatrix(nr, nc);
+    rng->fillUniform(m.vals.data(), m.vals.size(), a, b);
+    return m;
+}
+
+KMatrix KMatrix::normal(PRNG* rng, unsigned int nr, unsigned int nc, double mean, double sd) {
+    auto m = KMatrix(nr, nc);
+    rng->fillNormal(m.vals.data(), m.vals.size(), mean, sd);
+    return m;
 }
 
 
@@ -706,18 +716,249 @@ KMatrix KMatrix::vecInit(const vector<double> & vec, const unsigned int nr, cons
 }
 
 
-KMatrix firstEigenvector( const KMatrix& A, double tol) {
+// Eigenvalues of the symmetric tridiagonal matrix with diagonal d and
+// off-diagonal e (e[i] couples i and i+1), by the implicit QL method.
+// On return, d holds the eigenvalues, in no particular order. Each row of z
+// is rotated as a row of the identity would be, so z[r][j] becomes element
+// r of eigenvector j; passing only the rows one needs saves much work.
+static void tridiagEigen(vector<double> & d, vector<double> e, vector<vector<double>> & z) {
+    const int m = d.size();
+    e.resize(m, 0.0);
+    e[m - 1] = 0.0;
+    const unsigned int maxIter = 60;
+    for (int l = 0; l < m; l++) {
+        unsigned int iter = 0;
+        int mm = l;
+        do {
+            // find a negligible off-diagonal element, to split the matrix
+            for (mm = l; mm < m - 1; mm++) {
+                const double dd = fabs(d[mm]) + fabs(d[mm + 1]);
+                if (fabs(e[mm]) <= std::numeric_limits<double>::epsilon() * dd) {
+                    break;
+                }
+            }
+            if (mm != l) {
+                iter++;
+                if (iter > maxIter) {
+                    throw KException("tridiagEigen: iteration limit exceeded");
+                }
+                double g = (d[l + 1] - d[l]) / (2.0 * e[l]);
+                double r = sqrt(g*g + 1.0);
+                g = d[mm] - d[l] + e[l] / (g + ((g < 0.0) ? -r : r));
+                double sn = 1.0;
+                double c = 1.0;
+                double p = 0.0;
+                int i = mm - 1;
+                for (; i >= l; i--) {
+                    const double f = sn * e[i];
+                    const double bb = c * e[i];
+                    r = sqrt(f*f + g*g);
+                    e[i + 1] = r;
+                    if (0.0 == r) { // underflow, so start again
+                        d[i + 1] = d[i + 1] - p;
+                        e[mm] = 0.0;
+                        break;
+                    }
+                    sn = f / r;
+                    c = g / r;
+                    g = d[i + 1] - p;
+                    r = (d[i] - g)*sn + 2.0*c*bb;
+                    p = sn*r;
+                    d[i + 1] = g + p;
+                    g = c*r - bb;
+                    for (auto & zr : z) {
+                        const double zi1 = zr[i + 1];
+                        zr[i + 1] = sn*zr[i] + c*zi1;
+                        zr[i] = c*zr[i] - sn*zi1;
+                    }
+                }
+                if ((0.0 == r) && (i >= l)) {
+                    continue;
+                }
+                d[l] = d[l] - p;
+                e[l] = g;
+                e[mm] = 0.0;
+            }
+        } while (mm != l);
+    }
+    return;
+}
+
+
+// The Lanczos method, keeping the k Ritz pairs which come first by 'before'.
+static tuple<KMatrix, KMatrix> lanczos(const KMatrix& A, unsigned int k, double tol,
+                                       function<bool(double, double)> before,
+                                       unsigned int & iter) {
     const unsigned int n = A.numR();
-    if (A.numC() != n) { // must be square
-      throw KException("firstEigenvector: A is not a square matrix");
+    auto av = A.begin(); // row by row, so A*v can be done without temporaries
+
+    auto dotV = [n](const vector<double> & x, const vector<double> & y) {
+        double s = 0.0;
+        for (unsigned int i = 0; i < n; i++) {
+            s = s + x[i]*y[i];
+        }
+        return s;
+    };
+    auto unitV = [n, &dotV](vector<double> & x) {
+        const double nx = sqrt(dotV(x, x));
+        for (unsigned int i = 0; i < n; i++) {
+            x[i] = x[i] / nx;
+        }
+        return nx;
+    };
+    // full reorthogonalization, twice, as once is not always enough
+    auto orthoV = [n, &dotV](vector<double> & w, const vector<vector<double>> & basis) {
+        for (unsigned int pass = 0; pass < 2; pass++) {
+            for (auto & b : basis) {
+                const double c = dotV(w, b);
+                for (unsigned int i = 0; i < n; i++) {
+                    w[i] = w[i] - c*b[i];
+                }
+            }
+        }
+        return;
+    };
+
+    // a fixed start, which is unlikely to be orthogonal to any eigenvector
+    auto v = vector<double>(n, 0.0);
+    for (unsigned int i = 0; i < n; i++) {
+        v[i] = 1.0 + 0.5*sin(1.0 + i);
     }
-    if (1 >= n) {
-      throw KException("firstEigenvector: n must be greater than 1");
+    unitV(v);
+
+    auto basis = vector<vector<double>>();
+    auto alpha = vector<double>();
+    auto beta = vector<double>(); // beta[j] couples basis j and j+1
+    auto w = vector<double>(n, 0.0);
+    auto evs = vector<double>();
+    auto ndx = vector<unsigned int>();
+    auto rankBy = [&before](const vector<double> & es) {
+        auto nx = vector<unsigned int>(es.size());
+        for (unsigned int j = 0; j < es.size(); j++) {
+            nx[j] = j;
+        }
+        std::stable_sort(nx.begin(), nx.end(), [&es, &before](unsigned int i, unsigned int j) {
+            return before(es[i], es[j]);
+        });
+        return nx;
+    };
+    // restart directions, drawn from a fixed seed so results are repeatable
+    PRNG rng(KBase::dSeed);
+    double aNorm = 0.0;
+    iter = 0;
+    bool doneP = false;
+    unsigned int blk0 = 0; // where the current, uncoupled block of the basis starts
+
+    // Ritz values of alpha[j0..] and beta[j0..], and the last element of each Ritz vector
+    auto ritzLast = [&alpha, &beta](unsigned int j0, vector<double> & es) {
+        const unsigned int mb = alpha.size() - j0;
+        es = vector<double>(alpha.begin() + j0, alpha.end());
+        auto lastRow = vector<vector<double>>(1, vector<double>(mb, 0.0));
+        lastRow[0][mb - 1] = 1.0;
+        tridiagEigen(es, vector<double>(beta.begin() + j0, beta.end()), lastRow);
+        return lastRow[0];
+    };
+
+    while (!doneP) {
+        basis.push_back(v);
+        const unsigned int m = basis.size();
+        for (unsigned int i = 0; i < n; i++) {
+            double s = 0.0;
+            for (unsigned int j = 0; j < n; j++) {
+                s = s + av[i*n + j]*v[j];
+            }
+            w[i] = s;
+        }
+        iter++;
+        alpha.push_back(dotV(w, v));
+        orthoV(w, basis);
+        const double b = sqrt(dotV(w, w));
+        aNorm = (fabs(alpha[m - 1]) + b > aNorm) ? fabs(alpha[m - 1]) + b : aNorm;
+        // On breakdown the basis spans an invariant subspace, so every Ritz
+        // residual is zero, yet copies of repeated eigenvalues (and anything
+        // orthogonal to the start) are still missing: never stop there.
+        const bool brokeP = (b <= 1E-12 * aNorm);
+
+        // Ritz values from the tridiagonal projection of A; the residual
+        // of each Ritz pair is b times the last element of its vector.
+        doneP = (m == n);
+        if ((k <= m) && !doneP && !brokeP) {
+            auto conv = [tol, &aNorm](double res, double ev) {
+                return (res <= tol * fabs(ev)) || (res <= 1E-15 * aNorm);
+            };
+            const auto lastRow = ritzLast(0, evs);
+            ndx = rankBy(evs);
+            doneP = true;
+            for (unsigned int j = 0; (j < k) && doneP; j++) {
+                doneP = conv(b * fabs(lastRow[ndx[j]]), evs[ndx[j]]);
+            }
+            // Pairs from earlier blocks always look converged, so after a
+            // restart also wait for the leading pair of the new block, which
+            // may yet climb above them.
+            if (doneP && (0 < blk0)) {
+                auto bEvs = vector<double>();
+                const auto bLast = ritzLast(blk0, bEvs);
+                const unsigned int j0 = rankBy(bEvs)[0];
+                doneP = conv(b * fabs(bLast[j0]), bEvs[j0]);
+            }
+        }
+        if (!doneP) {
+            if (!brokeP) {
+                for (unsigned int i = 0; i < n; i++) {
+                    v[i] = w[i] / b;
+                }
+                beta.push_back(b);
+            }
+            else {
+                // carry on from a random direction orthogonal to the basis,
+                // which starts a new block uncoupled from the old ones
+                double nv = 0.0;
+                while (nv < 1E-8) {
+                    for (unsigned int i = 0; i < n; i++) {
+                        v[i] = rng.uniform(-1.0, 1.0);
+                    }
+                    orthoV(v, basis);
+                    nv = sqrt(dotV(v, v));
+                }
+                unitV(v);
+                beta.push_back(0.0);
+                blk0 = m;
+            }
+        }
     }
-    if (0.0 >= tol) {
-      throw KException("firstEigenvector: tol must be positive");
+
+    // the whole of the chosen Ritz vectors, mapped back from the Lanczos basis
+    const unsigned int m = basis.size();
+    auto S = vector<vector<double>>(m, vector<double>(m, 0.0));
+    for (unsigned int l = 0; l < m; l++) {
+        S[l][l] = 1.0;
     }
+    evs = alpha;
+    tridiagEigen(evs, beta, S);
+    ndx = rankBy(evs);
+    auto vals = KMatrix(k, 1);
+    auto vecs = KMatrix(n, k);
+    for (unsigned int j = 0; j < k; j++) {
+        vals(j, 0) = evs[ndx[j]];
+        auto x = vector<double>(n, 0.0);
+        for (unsigned int l = 0; l < m; l++) {
+            const double slj = S[l][ndx[j]];
+            for (unsigned int i = 0; i < n; i++) {
+                x[i] = x[i] + slj*basis[l][i];
+            }
+        }
+        unitV(x);
+        for (unsigned int i = 0; i < n; i++) {
+            vecs(i, j) = x[i];
+        }
+    }
+    return tuple<KMatrix, KMatrix>(vals, vecs);
+}
 
+
+// Damped power iteration, for non-symmetric matrices
+static KMatrix powerEigenvector( const KMatrix& A, double tol, unsigned int & iter) {
+    const unsigned int n = A.numR();
     auto mDelta = [](const KMatrix& m1, const KMatrix& m2) {
         auto diff = norm(m1-m2);
         auto sum = norm(m1)+norm(m2);
@@ -727,7 +968,7 @@ KMatrix firstEigenvector( const KMatrix& A, double tol) {
 
 
     double change = 2.0 * tol;
-    unsigned int iter = 0;
+    iter = 0;
     const unsigned int maxIter = 10000;
     auto x = unitize(KMatrix(n, 1, 1.0));
 
@@ -759,6 +1000,76 @@ KMatrix firstEigenvector( const KMatrix& A, double tol) {
     if (true) {
         LOG(INFO) << KBase::getFormattedString("After iteration %u, delta is %.4e", iter, change);
     }
+    return x;
+}
+
+tuple<KMatrix, KMatrix> topEigenpairs(const KMatrix& A, unsigned int k, double tol,
+                                      unsigned int & iter) {
+    const unsigned int n = A.numR();
+    if (A.numC() != n) { // must be square
+      throw KException("topEigenpairs: A is not a square matrix");
+    }
+    if ((0 == k) || (n < k)) {
+      throw KException("topEigenpairs: k must be in [1, n]");
+    }
+    if (0.0 >= tol) {
+      throw KException("topEigenpairs: tol must be positive");
+    }
+    const double symTol = 1E-12 * maxAbs(A);
+    for (unsigned int i = 0; i < n; i++) {
+        for (unsigned int j = 0; j < i; j++) {
+            if (fabs(A(i, j) - A(j, i)) > symTol) {
+              throw KException("topEigenpairs: A is not symmetric");
+            }
+        }
+    }
+    auto larger = [](double x, double y) {
+        return (x > y);
+    };
+    return lanczos(A, k, tol, larger, iter);
+}
+
+
+KMatrix firstEigenvector( const KMatrix& A, double tol) {
+    unsigned int iter = 0;
+    return firstEigenvector(A, tol, iter);
+}
+
+
+KMatrix firstEigenvector( const KMatrix& A, double tol, unsigned int & iter) {
+    const unsigned int n = A.numR();
+    if (A.numC() != n) { // must be square
+      throw KException("firstEigenvector: A is not a square matrix");
+    }
+    if (1 >= n) {
+      throw KException("firstEigenvector: n must be greater than 1");
+    }
+    if (0.0 >= tol) {
+      throw KException("firstEigenvector: tol must be positive");
+    }
+
+    bool symP = true;
+    const double symTol = 1E-12 * maxAbs(A);
+    for (unsigned int i = 0; (i < n) && symP; i++) {
+        for (unsigned int j = 0; (j < i) && symP; j++) {
+            symP = (fabs(A(i, j) - A(j, i)) <= symTol);
+        }
+    }
+
+    KMatrix x;
+    if (symP) {
+        // as power iteration would find, the eigenvalue of largest magnitude
+        auto largerAbs = [](double a, double b) {
+            return (fabs(a) > fabs(b));
+        };
+        x = get<1>(lanczos(A, 1, tol, largerAbs, iter));
+        if (true) {
+            LOG(INFO) << KBase::getFormattedString("After %u Lanczos steps", iter);
+        }
+    }
+    else {
+        x = powerEigenvector(A, tol, iter);
+    }
 
     // The eigenvector is unique only up to the sign.
     // So when the answer can be all negative or all positive,
@@ -770,6 +1081,7 @@ KMatrix firstEigenvector( const KMatrix& A, double tol) {
     return x;
 }
 
+
 } // end of namespace
 
 // --------------------------------------------
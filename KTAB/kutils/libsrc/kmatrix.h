@@ -88,7 +88,22 @@ KMatrix rescaleRows(const KMatrix& m1, const double vMin, const double vMax);
 
 // If the eigenvector is complex, this will throw an exception.
 // So mathmatically analyze the situation before using this function.
+// A symmetric A is solved by topEigenpairs, for the eigenvalue of largest
+// magnitude; otherwise, this uses damped power iteration. Either way,
+// iter returns the number of products with A.
 KMatrix firstEigenvector( const KMatrix& A, double tol);
+KMatrix firstEigenvector( const KMatrix& A, double tol, unsigned int & iter);
+
+// The k largest eigenvalues of a symmetric matrix, in decreasing order as a
+// column-vector, and their unit eigenvectors, as the columns of an n-by-k matrix.
+// This is the Lanczos method with full reorthogonalization, which needs far fewer
+// products with A than power iteration when the leading eigenvalues are close.
+// It stops when each pair has |Av - ev| <= tol*|e|, or when the Krylov space is
+// the whole space. When the Krylov space becomes invariant, it restarts from a
+// random direction orthogonal to it, so repeated eigenvalues keep their
+// multiplicity. iter returns the number of Lanczos steps (products with A).
+tuple<KMatrix, KMatrix> topEigenpairs(const KMatrix& A, unsigned int k, double tol,
+                                      unsigned int & iter);
 
 // -------------------------------------------------
 
@@ -106,6 +121,7 @@ public:
     unsigned int numR() const;
     unsigned int numC() const;
     static KMatrix uniform(PRNG* rng, unsigned int nr, unsigned int nc, double a, double b);
+    static KMatrix normal(PRNG* rng, unsigned int nr, unsigned int nc, double mean, double sd);
 
     // this builds a matrix by mapping a function over integer ranges,
     // setting each element to the returned value
@@ -0,0 +1,167 @@
+﻿// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 King Abdullah Petroleum Studies and Research Center
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+// --------------------------------------------
+// Per-turn, per-phase timers and counters for model runs.
+// --------------------------------------------
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include "kutils.h"
+#include "kmetrics.h"
+
+namespace KBase {
+
+std::atomic<bool> KMetrics::onP(false);
+std::atomic<unsigned int> KMetrics::curTurn(0);
+
+namespace {
+std::mutex mtxMetrics;
+std::map<std::pair<unsigned int, string>, KMetrics::Stat> metrics;
+
+KMetrics::Stat & statFor(unsigned int t, const char * phase) { // caller holds mtxMetrics
+  auto & s = metrics[std::make_pair(t, string(phase))];
+  if (0 == s.phase.length()) {
+    s.turn = t;
+    s.phase = phase;
+  }
+  return s;
+}
+} // end of anonymous namespace
+
+
+void KMetrics::setEnabled(bool on) {
+  onP.store(on);
+}
+
+void KMetrics::reset() {
+  std::lock_guard<std::mutex> lk(mtxMetrics);
+  metrics.clear();
+  curTurn.store(0);
+}
+
+void KMetrics::setTurn(unsigned int t) {
+  curTurn.store(t, std::memory_order_relaxed);
+}
+
+unsigned int KMetrics::turn() {
+  return curTurn.load(std::memory_order_relaxed);
+}
+
+void KMetrics::addTime(const char * phase, double secs) {
+  if (!enabled()) {
+    return;
+  }
+  unsigned int bin = 0;
+  double us = secs * 1E6;
+  while ((1.0 <= us) && (bin + 1 < numBins)) {
+    us = us / 2.0;
+    bin++;
+  }
+  std::lock_guard<std::mutex> lk(mtxMetrics);
+  auto & s = statFor(turn(), phase);
+  s.minSec = (0 == s.calls) ? secs : std::min(s.minSec, secs);
+  s.maxSec = (0 == s.calls) ? secs : std::max(s.maxSec, secs);
+  s.calls = s.calls + 1;
+  s.totalSec = s.totalSec + secs;
+  s.hist[bin] = s.hist[bin] + 1;
+}
+
+void KMetrics::count(const char * phase, uint64_t n) {
+  if (!enabled()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lk(mtxMetrics);
+  auto & s = statFor(turn(), phase);
+  s.count = s.count + n;
+}
+
+vector<KMetrics::Stat> KMetrics::snapshot() {
+  std::lock_guard<std::mutex> lk(mtxMetrics);
+  auto v = vector<Stat>();
+  v.reserve(metrics.size());
+  for (const auto & m : metrics) {
+    v.push_back(m.second);
+  }
+  return v;
+}
+
+string KMetrics::toCSV() {
+  std::ostringstream os;
+  os << "Turn,Phase,Calls,Count,TotalSec,MinSec,MaxSec";
+  for (unsigned int b = 0; b < numBins; b++) {
+    os << ",Hist" << b;
+  }
+  os << "\n";
+  for (const auto & s : snapshot()) {
+    os << s.turn << "," << s.phase << "," << s.calls << "," << s.count << ","
+       << getFormattedString("%.9f,%.9f,%.9f", s.totalSec, s.minSec, s.maxSec);
+    for (auto h : s.hist) {
+      os << "," << h;
+    }
+    os << "\n";
+  }
+  return os.str();
+}
+
+string KMetrics::toJSON() {
+  std::ostringstream os;
+  os << "[";
+  bool firstP = true;
+  for (const auto & s : snapshot()) {
+    os << (firstP ? "\n" : ",\n");
+    firstP = false;
+    os << "  {\"turn\": " << s.turn << ", \"phase\": \"" << s.phase << "\""
+       << ", \"calls\": " << s.calls << ", \"count\": " << s.count
+       << getFormattedString(", \"totalSec\": %.9f, \"minSec\": %.9f, \"maxSec\": %.9f",
+                             s.totalSec, s.minSec, s.maxSec)
+       << ", \"hist\": [";
+    for (unsigned int b = 0; b < s.hist.size(); b++) {
+      os << ((0 == b) ? "" : ", ") << s.hist[b];
+    }
+    os << "]}";
+  }
+  os << "\n]\n";
+  return os.str();
+}
+
+void KMetrics::write(const string & fileName) {
+  const string ext = ".json";
+  const bool jsonP = (fileName.length() >= ext.length()) &&
+                     (0 == fileName.compare(fileName.length() - ext.length(), ext.length(), ext));
+  std::ofstream out(fileName);
+  if (!out) {
+    throw KException("KMetrics::write: could not open " + fileName);
+  }
+  out << (jsonP ? toJSON() : toCSV());
+  if (!out) {
+    throw KException("KMetrics::write: could not write " + fileName);
+  }
+}
+
+} // end of namespace
+
+// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
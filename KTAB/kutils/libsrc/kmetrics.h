@@ -0,0 +1,115 @@
+﻿// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 King Abdullah Petroleum Studies and Research Center
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+// -------------------------------------------------
+// Lightweight run instrumentation: per-turn, per-phase timers and counters.
+//
+// Everything is a no-op unless KMetrics::setEnabled(true) has been called;
+// a disabled KPhaseTimer costs one relaxed atomic load. Phase names are
+// string literals. The turn is whatever Model::run last set, so metrics
+// from concurrently running models are merged.
+// -------------------------------------------------
+#ifndef KBASE_KMETRICS_H
+#define KBASE_KMETRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace KBase {
+
+using std::string;
+using std::vector;
+
+class KMetrics {
+public:
+  // bin b holds durations in [2^(b-1), 2^b) microseconds; bin 0 is under 1us,
+  // and the last bin is open-ended
+  static const unsigned int numBins = 24;
+
+  struct Stat {
+    unsigned int turn = 0;
+    string phase = "";
+    uint64_t calls = 0; // timed calls
+    double totalSec = 0.0;
+    double minSec = 0.0;
+    double maxSec = 0.0;
+    uint64_t count = 0; // sum of count() increments
+    vector<uint64_t> hist = vector<uint64_t>(numBins, 0);
+  };
+
+  static bool enabled() {
+    return onP.load(std::memory_order_relaxed);
+  }
+  static void setEnabled(bool on);
+  static void reset(); // discard everything recorded so far
+
+  static void setTurn(unsigned int t);
+  static unsigned int turn();
+
+  static void addTime(const char * phase, double secs);
+  static void count(const char * phase, uint64_t n = 1);
+
+  // sorted by turn, then phase
+  static vector<Stat> snapshot();
+
+  static string toCSV();
+  static string toJSON();
+  // writes JSON if the name ends in ".json", CSV otherwise; throws KException on failure
+  static void write(const string & fileName);
+
+private:
+  static std::atomic<bool> onP;
+  static std::atomic<unsigned int> curTurn;
+};
+
+// times its own lifetime, attributing it to the given phase of the current turn
+class KPhaseTimer {
+public:
+  explicit KPhaseTimer(const char * ph) : phase(ph), onP(KMetrics::enabled()) {
+    if (onP) {
+      t0 = std::chrono::steady_clock::now();
+    }
+  }
+  ~KPhaseTimer() {
+    if (onP) {
+      const std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+      KMetrics::addTime(phase, dt.count());
+    }
+  }
+  KPhaseTimer(const KPhaseTimer &) = delete;
+  KPhaseTimer & operator=(const KPhaseTimer &) = delete;
+
+private:
+  const char * phase;
+  const bool onP;
+  std::chrono::steady_clock::time_point t0;
+};
+
+} // end of namespace
+
+// -------------------------------------------------
+#endif
+// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
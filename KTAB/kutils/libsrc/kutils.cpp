@@ -24,6 +24,7 @@
 // --------------------------------------------
 
 //#include <assert.h>
+#include <atomic>
 #include <tuple>
 #include <easylogging++.h>
 
@@ -151,6 +152,17 @@ void printVUI(const VUI& p) {
 
 // --------------------------------------------
 
+static std::atomic<unsigned int> maxThreads(0);
+
+void setMaxThreads(unsigned int n) {
+  maxThreads.store(n);
+  return;
+}
+
+unsigned int getMaxThreads() {
+  return maxThreads.load();
+}
+
 void groupThreads(function<void(unsigned int)> tfn,
                   unsigned int numLow, unsigned int numHigh, unsigned int numPar) {
   const auto rl = ReportingLevel::Silent;
@@ -158,7 +170,10 @@ void groupThreads(function<void(unsigned int)> tfn,
   const unsigned int threadsPerHWC = 4;
   unsigned int numHWC = 0;
   const unsigned int dfltNumThreads = 10;
-  if (0 == numPar) { // no specific number requested, so guess
+  if (0 == numPar) { // no specific number requested, so use the cap, if any
+    numPar = maxThreads.load();
+  }
+  if (0 == numPar) { // no cap either, so guess
 
     // As of OCt. 2016, this function might or might not have one or two
     // of the following problems, depending on your implementation.
@@ -87,6 +87,11 @@ double trim(double x, double minX, double maxX, bool strict = false);
 void groupThreads(function<void(unsigned int)> tfn,
                   unsigned int numLow, unsigned int numHigh, unsigned int numPar=0);
 
+// Caps the group size groupThreads uses when no numPar is given,
+// e.g. to measure scaling by thread count. Zero restores the guess.
+void setMaxThreads(unsigned int n);
+unsigned int getMaxThreads();
+
 // ----------------------------------------------
 
 std::chrono::time_point<std::chrono::system_clock>  displayProgramStart(string appName = "", string appVersion = "");
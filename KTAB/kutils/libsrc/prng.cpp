@@ -24,6 +24,8 @@
 
 //#include <assert.h>
 
+#include <cmath>
+#include <sstream>
 #include "prng.h"
 
 
@@ -160,6 +162,10 @@ double PRNG::uniform(double a, double b) {
 }
 
 unsigned int PRNG::probSel(const KMatrix & cv) {
+  return probSel(cv, uniform(0.0, 1.0));
+}
+
+unsigned int PRNG::probSel(const KMatrix & cv, double p) {
   const unsigned int nr = cv.numR();
   if (0 >= nr) {
     throw KException("PRNG::probSel: cv matrix has got no records");
@@ -173,7 +179,6 @@ unsigned int PRNG::probSel(const KMatrix & cv) {
   }
 
   int iMax = -1;
-  const double p = uniform(0.0, 1.0);
   double sum = 0.0;
   for (unsigned int i = 0; (i < nr) && (iMax < 0); i++) {
     sum = sum + cv(i, 0);
@@ -189,6 +194,22 @@ unsigned int PRNG::probSel(const KMatrix & cv) {
 };
 
 
+std::string PRNG::getState() const {
+  std::ostringstream os;
+  os << mt;
+  return os.str();
+}
+
+void PRNG::setState(const std::string & st) {
+  std::istringstream is(st);
+  is >> mt;
+  if (is.fail()) {
+    throw KException("PRNG::setState: could not parse the engine state");
+  }
+  return;
+}
+
+
 uint64_t PRNG::uniform() {
   const uint64_t max = 0xFFFFFFFFFFFFFFFF;
   std::uniform_int_distribution<uint64_t> dist(0, max);
@@ -196,6 +217,88 @@ uint64_t PRNG::uniform() {
   return qTrans(n);
 }
 
+void PRNG::fillUniform(uint64_t* out, size_t n) {
+  std::uniform_int_distribution<uint64_t> dist(0, 0xFFFFFFFFFFFFFFFF);
+  for (size_t i = 0; i < n; i++) {
+    out[i] = dist(mt);
+  }
+  // a separate pass, as the engine is serial but this is not
+  for (size_t i = 0; i < n; i++) {
+    out[i] = qTrans(out[i]);
+  }
+  return;
+}
+
+
+void PRNG::fillUniform(double* out, size_t n, double a, double b) {
+  const unsigned int chunk = 256;
+  uint64_t buf[chunk];
+  size_t i0 = 0;
+  while (i0 < n) {
+    const size_t m = ((n - i0) < chunk) ? (n - i0) : chunk;
+    fillUniform(buf, m);
+    for (size_t k = 0; k < m; k++) {
+      const double x = ((double)buf[k]) / ((double)0xFFFFFFFFFFFFFFFF);
+      out[i0 + k] = a + ((b - a)*x);
+    }
+    i0 = i0 + m;
+  }
+  return;
+}
+
+
+void PRNG::fillNormal(double* out, size_t n, double mean, double sd) {
+  const double twoPi = 2.0 * 3.14159265358979323846;
+  const double twoM53 = 1.0 / 9007199254740992.0; // 2^-53
+  const unsigned int chunk = 256; // even, so pairs never straddle chunks
+  uint64_t buf[chunk];
+  size_t i0 = 0;
+  while (i0 < n) {
+    const size_t m = ((n - i0) < chunk) ? (n - i0) : chunk;
+    const size_t mp = m + (m % 2); // a whole number of pairs
+    fillUniform(buf, mp);
+    for (size_t k = 0; k < mp; k += 2) {
+      const double u1 = ((double)((buf[k] >> 11) + 1)) * twoM53; // (0,1], so log is finite
+      const double u2 = ((double)(buf[k + 1] >> 11)) * twoM53;   // [0,1)
+      const double r = sqrt(-2.0 * log(u1));
+      out[i0 + k] = mean + (sd * r * cos(twoPi * u2));
+      if (k + 1 < m) {
+        out[i0 + k + 1] = mean + (sd * r * sin(twoPi * u2));
+      }
+    }
+    i0 = i0 + m;
+  }
+  return;
+}
+
+
+void PRNG::fillBernoulli(uint64_t* out, size_t nBits, double p) {
+  const size_t nWords = (nBits + 63) / 64;
+  const unsigned int tail = nBits % 64;
+  if (0.5 == p) { // each draw is already 64 fair bits
+    fillUniform(out, nWords);
+  }
+  else {
+    const unsigned int chunk = 64;
+    uint64_t buf[chunk];
+    for (size_t w = 0; w < nWords; w++) {
+      const unsigned int nb = ((w + 1 == nWords) && (0 < tail)) ? tail : chunk;
+      fillUniform(buf, nb);
+      uint64_t word = 0;
+      for (unsigned int k = 0; k < nb; k++) {
+        const double x = ((double)buf[k]) / ((double)0xFFFFFFFFFFFFFFFF);
+        word = word | (((uint64_t)(x < p)) << k);
+      }
+      out[w] = word;
+    }
+  }
+  if (0 < tail) {
+    out[nWords - 1] = out[nWords - 1] & ((((uint64_t)1) << tail) - 1);
+  }
+  return;
+}
+
+
 VBool PRNG::bits(unsigned int nb) {
   VBool bv = {};
   bv.resize(nb);
@@ -215,6 +318,125 @@ VBool PRNG::bits(unsigned int nb) {
   return bv;
 }
 
+
+// -------------------------------------------------
+
+CPRNG::CPRNG(uint64_t sd) {
+  setSeed(sd);
+}
+
+
+CPRNG::~CPRNG() { }
+
+
+uint64_t CPRNG::setSeed(uint64_t s) {
+  if (0 == s) {
+    std::random_device rd;
+    mt19937_64 mt1(rd());
+    std::uniform_int_distribution<uint64_t> dist(0, 0xFFFFFFFFFFFFFFFF);
+    s = dist(mt1);
+  }
+  key = s;
+  pos = 0;
+  blkP = false;
+  return s;
+}
+
+
+void CPRNG::philox(uint32_t ctr[4], uint64_t k) {
+  const uint64_t M0 = 0xD2511F53;
+  const uint64_t M1 = 0xCD9E8D57;
+  const uint32_t W0 = 0x9E3779B9; // golden ratio
+  const uint32_t W1 = 0xBB67AE85; // sqrt(3) - 1
+  uint32_t k0 = ((uint32_t)(k & MASK32));
+  uint32_t k1 = ((uint32_t)(k >> 32));
+  for (unsigned int r = 0; r < 10; r++) {
+    if (0 < r) {
+      k0 = k0 + W0;
+      k1 = k1 + W1;
+    }
+    const uint64_t p0 = M0 * ctr[0];
+    const uint64_t p1 = M1 * ctr[2];
+    const uint32_t c1 = ctr[1];
+    const uint32_t c3 = ctr[3];
+    ctr[0] = ((uint32_t)(p1 >> 32)) ^ c1 ^ k0;
+    ctr[1] = ((uint32_t)(p1 & MASK32));
+    ctr[2] = ((uint32_t)(p0 >> 32)) ^ c3 ^ k1;
+    ctr[3] = ((uint32_t)(p0 & MASK32));
+  }
+  return;
+}
+
+
+uint64_t CPRNG::uniform() {
+  // draws use the counters (n, 0), and splits use (id, 1), so they never meet
+  const uint64_t b = pos / 2;
+  if (!blkP || (b != blkNum)) {
+    uint32_t ctr[4] = { ((uint32_t)(b & MASK32)), ((uint32_t)(b >> 32)), 0, 0 };
+    philox(ctr, key);
+    blk[0] = (((uint64_t)ctr[1]) << 32) | ctr[0];
+    blk[1] = (((uint64_t)ctr[3]) << 32) | ctr[2];
+    blkNum = b;
+    blkP = true;
+  }
+  const uint64_t n = blk[pos % 2];
+  pos++;
+  return n;
+}
+
+
+double CPRNG::uniform(double a, double b) {
+  uint64_t n = uniform();
+  double x = ((double)n) / ((double)0xFFFFFFFFFFFFFFFF);
+  x = a + ((b - a)*x);
+  return x;
+}
+
+
+unsigned int CPRNG::probSel(const KMatrix & cv) {
+  return PRNG::probSel(cv, uniform(0.0, 1.0));
+}
+
+
+VBool CPRNG::bits(unsigned int nb) {
+  VBool bv = {};
+  bv.resize(nb);
+  uint64_t rNum = 0;
+  for (unsigned int i = 0; i < nb; i++) {
+    if (0 == (i % 64)) {
+      rNum = uniform();
+    }
+    bv[i] = (1 == (rNum & 0x1));
+    rNum = rNum >> 1;
+  }
+  return bv;
+}
+
+
+CPRNG CPRNG::split(uint64_t streamId) const {
+  uint32_t ctr[4] = { ((uint32_t)(streamId & MASK32)), ((uint32_t)(streamId >> 32)), 1, 0 };
+  philox(ctr, key);
+  CPRNG child(1); // any nonzero seed, replaced below
+  child.key = (((uint64_t)ctr[1]) << 32) | ctr[0];
+  return child;
+}
+
+
+void CPRNG::skipAhead(uint64_t n) {
+  pos = pos + n;
+  return;
+}
+
+
+uint64_t CPRNG::getKey() const {
+  return key;
+}
+
+
+uint64_t CPRNG::getPosition() const {
+  return pos;
+}
+
 } // end of namespace
 
 // --------------------------------------------
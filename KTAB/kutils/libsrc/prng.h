@@ -71,12 +71,66 @@ public:
   uint64_t uniform();
   double uniform(double a, double b);
   unsigned int probSel(const KMatrix & cv);
+  // select by a uniform p drawn earlier, so that parallel callers can
+  // draw their p serially and in a fixed order
+  static unsigned int probSel(const KMatrix & cv, double p);
   VBool bits(unsigned int nb);
   uint64_t setSeed(uint64_t sd);
+
+  // Bulk draws, with the same values in the same order as n calls of
+  // uniform() or uniform(a,b), but generated in tight loops over a buffer.
+  void fillUniform(uint64_t* out, size_t n);
+  void fillUniform(double* out, size_t n, double a, double b);
+  // normal deviates, by the Box-Muller transform of pairs of draws
+  void fillNormal(double* out, size_t n, double mean, double sd);
+  // nBits independent bits, each set with probability p, packed 64 to a word
+  // from the low bit up; the unused high bits of the last word are zero
+  void fillBernoulli(uint64_t* out, size_t nBits, double p);
+
+  // the full engine state, so that a run can be checkpointed and resumed exactly
+  std::string getState() const;
+  void setState(const std::string & st);
 protected:
   mt19937_64 mt = mt19937_64();
 };
 
+
+// Counter-based generator: Philox4x32-10, from Salmon et al (2011),
+// "Parallel random numbers: as easy as 1, 2, 3". The n-th draw is a pure
+// function of a 64-bit key and n, so a stream can be split off or skipped
+// ahead in constant time, and streams share no state at all. Thus each
+// (seed, actor, turn, replicate) can get its own independent stream,
+//   CPRNG(seed).split(actor).split(turn).split(rep)
+// and a parallel run gets the same draws however its tasks are scheduled.
+class CPRNG {
+public:
+  explicit CPRNG(uint64_t sd = KBase::dSeed);
+  virtual ~CPRNG();
+  uint64_t uniform();
+  double uniform(double a, double b);
+  unsigned int probSel(const KMatrix & cv);
+  VBool bits(unsigned int nb);
+  uint64_t setSeed(uint64_t sd); // as for PRNG, zero means a random seed
+
+  // a stream with its own key, derived from this key and streamId; the
+  // draws of this stream are unaffected
+  CPRNG split(uint64_t streamId) const;
+  void skipAhead(uint64_t n); // as if uniform() had been called n times
+  uint64_t getKey() const;
+  uint64_t getPosition() const; // draws so far
+
+  // the ten rounds of Philox4x32, applied to ctr in place
+  static void philox(uint32_t ctr[4], uint64_t key);
+
+protected:
+  uint64_t key = 0;
+  uint64_t pos = 0;
+  // each block of 128 bits gives two draws, so remember the last one
+  uint64_t blkNum = 0;
+  uint64_t blk[2] = { 0, 0 };
+  bool blkP = false;
+};
+
 };
 
 // -------------------------------------------------
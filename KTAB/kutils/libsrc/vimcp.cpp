@@ -25,11 +25,13 @@
 // "Finite-Dimensional Variational Inequalities and Complementarity Problems" by Facchinei and Pang
 // -------------------------------------------------
 
+#include <algorithm>
 #include "vimcp.h"
 #include <easylogging++.h>
 
 namespace KBase {
 
+using std::get;
 using std::tuple;
 
 KMatrix projPos(const KMatrix & w) {
@@ -115,19 +117,26 @@ tuple<KMatrix, unsigned int, KMatrix> viABG(const KMatrix & xInit,
 // "A Modified Projection and Contraction Method for a Class of Linear Complementarity Problems",
 // B. S. He, Nanjing University, in Journal of Computational Mathematics, 1996
 
-tuple<KMatrix, unsigned int, KMatrix> viBSHe96(const KMatrix & M, const KMatrix & q,
-                                               function<KMatrix(const KMatrix &)> pK,
-                                               KMatrix u0, const double eps, const unsigned int iMax) {
-  if (false) {
-    LOG(INFO) << "Received M:";
-    M.mPrintf("%+.4f  ");
-    LOG(INFO) << "Received q:";
-    trans(q).mPrintf("%+.4f  ");
-  }
+static KMatrix identityPlus(const KMatrix & m) {
+  return iMat(m.numR()) + m;
+}
 
-  unsigned int n = q.numR();
-  if (1 != q.numC()) {
-    throw KException("viBSHe96: q matrix doesn't have one column");
+static CSRMatrix identityPlus(const CSRMatrix & m) {
+  return m.plusIdentity();
+}
+
+// Shared by the dense and sparse versions, which differ only in the type of
+// M, as all the solver does with it is multiply. IMt is I + M', or null to
+// have it computed here.
+template <class MT>
+tuple<KMatrix, unsigned int, KMatrix> bshe96(const MT & M, const MT & Mt, const MT * IMt,
+                                             const KMatrix & q,
+                                             function<KMatrix(const KMatrix &)> pK,
+                                             KMatrix u0, const double eps, const unsigned int iMax) {
+  const unsigned int n = q.numR();
+  const unsigned int k = q.numC();
+  if (0 == k) {
+    throw KException("viBSHe96: q matrix doesn't have any columns");
   }
   if (n != M.numR()) {
     throw KException(string("viBSHe96: M matrix doesn't have ") + std::to_string(n) + " rows");
@@ -138,56 +147,312 @@ tuple<KMatrix, unsigned int, KMatrix> viBSHe96(const KMatrix & M, const KMatrix
   if (n != u0.numR()) {
     throw KException(string("viBSHe96: u0 matrix doesn't have ") + std::to_string(n) + " rows");
   }
-  if (1 != u0.numC()) {
-    throw KException(string("viBSHe96: u0 matrix doesn't have ") + std::to_string(n) + " column");
+  if (k != u0.numC()) {
+    throw KException(string("viBSHe96: u0 matrix doesn't have ") + std::to_string(k) + " column");
   }
   if (eps <= 0.0) {
     throw KException("viBSHe96: eps must be positive");
   }
 
+  // The step size uses (I + M')e as one product, rather than e + M'e, as they round differently.
+  const MT IMtHere = (nullptr == IMt) ? identityPlus(Mt) : MT();
+  const MT & IMtRef = (nullptr == IMt) ? IMtHere : *IMt;
+
   double gamma = 1.8; // any 0<gamma<2 will do. Note that 1.618034 = (1+sqrt(5))/2
-  KMatrix Mt = trans(M);
-  double qMax = maxAbs(q);
-  if (qMax <= 0.0) {
-    throw KException("viBSHe96: qMax must be positive");
-  }
-  KMatrix I = iMat(n);
-
-  // for general VI, e(u) = u - pK(u - F(u))
-  // will have e(u)=0 iff u solves the VI.
-  auto err = [&M, &q, pK](const KMatrix & u) {
-    KMatrix proj = pK(u - (M*u + q));
-    return (u - proj);
+
+  // the column-by-column versions of maxAbs and squared norm
+  auto cMaxAbs = [n](const KMatrix & m, unsigned int j) {
+    double x = 0.0;
+    for (unsigned int i = 0; i < n; i++) {
+      x = (fabs(m(i, j)) > x) ? fabs(m(i, j)) : x;
+    }
+    return x;
   };
-  auto normS = [](const KMatrix & m) {
-    double n = norm(m);
-    return (n*n);
+  auto cNormS = [n](const KMatrix & m, unsigned int j) {
+    double s = 0.0;
+    for (unsigned int i = 0; i < n; i++) {
+      s = s + (m(i, j)*m(i, j));
+    }
+    const double nrm = sqrt(s);
+    return (nrm*nrm);
   };
 
+  auto qMax = vector<double>(k, 0.0);
+  for (unsigned int j = 0; j < k; j++) {
+    qMax[j] = cMaxAbs(q, j);
+    if (qMax[j] <= 0.0) {
+      throw KException("viBSHe96: qMax must be positive");
+    }
+  }
 
+  // For general VI, e(u) = u - pK(u - F(u))
+  // will have e(u)=0 iff u solves the VI. Here F(u) = Mu+q, and the
+  // Mu from each error is kept for the next iteration's gradient.
   KMatrix u1 = pK(u0); // project onto K before first iteration
-  KMatrix e1 = err(u1);
-  double r = maxAbs(e1) / qMax;
+  KMatrix f1 = M*u1 + q;
+  KMatrix e1 = u1 - pK(u1 - f1);
+  auto activeP = vector<bool>(k, false);
+  unsigned int numActive = 0;
+  for (unsigned int j = 0; j < k; j++) {
+    activeP[j] = (cMaxAbs(e1, j) / qMax[j] > eps);
+    numActive = numActive + (activeP[j] ? 1 : 0);
+  }
   unsigned int iter = 0;
 
-  while (r > eps) {
-    KMatrix g1 = Mt*e1 + (M*u1 + q);
-    double rho = normS(e1) / normS((I + Mt)*e1);
-    KMatrix u2 = pK(u1 - gamma*rho*g1);
-    KMatrix e2 = err(u2);
+  while (0 < numActive) {
+    KMatrix g1 = Mt*e1 + f1;
+    KMatrix d1 = IMtRef*e1;
+    KMatrix step = KMatrix(n, k);
+    for (unsigned int j = 0; j < k; j++) {
+      if (activeP[j]) {
+        double rho = cNormS(e1, j) / cNormS(d1, j);
+        for (unsigned int i = 0; i < n; i++) {
+          step(i, j) = gamma*rho*g1(i, j);
+        }
+      }
+    }
+    KMatrix u2 = pK(u1 - step);
+    KMatrix f2 = M*u2 + q;
+    KMatrix e2 = u2 - pK(u2 - f2);
 
     iter++;
     if (iter >= iMax) {
       throw KException("viBSHe96: iteration number crossed the upper limit");
     }
-    u1 = u2;
-    e1 = e2;
-    r = maxAbs(e1) / qMax;
+    for (unsigned int j = 0; j < k; j++) {
+      if (activeP[j]) {
+        for (unsigned int i = 0; i < n; i++) {
+          u1(i, j) = u2(i, j);
+          f1(i, j) = f2(i, j);
+          e1(i, j) = e2(i, j);
+        }
+        if (cMaxAbs(e1, j) / qMax[j] <= eps) {
+          activeP[j] = false;
+          numActive--;
+        }
+      }
+    }
   }
   auto trpl = tuple<KMatrix, unsigned int, KMatrix>(u1, iter, e1);
   return trpl;
 }
 
+
+tuple<KMatrix, unsigned int, KMatrix> viBSHe96(const KMatrix & M, const KMatrix & q,
+                                               function<KMatrix(const KMatrix &)> pK,
+                                               KMatrix u0, const double eps, const unsigned int iMax) {
+  if (false) {
+    LOG(INFO) << "Received M:";
+    M.mPrintf("%+.4f  ");
+    LOG(INFO) << "Received q:";
+    trans(q).mPrintf("%+.4f  ");
+  }
+  return bshe96(M, trans(M), (const KMatrix *)nullptr, q, pK, u0, eps, iMax);
+}
+
+
+tuple<KMatrix, unsigned int, KMatrix> viBSHe96(const CSRMatrix & M, const KMatrix & q,
+                                               function<KMatrix(const KMatrix &)> pK,
+                                               KMatrix u0, const double eps, const unsigned int iMax) {
+  return bshe96(M, M.trans(), (const CSRMatrix *)nullptr, q, pK, u0, eps, iMax);
+}
+
+
+// -------------------------------------------------
+CSRMatrix::CSRMatrix() { }
+
+
+CSRMatrix::CSRMatrix(const KMatrix & m, double dropTol) {
+  rows = m.numR();
+  clms = m.numC();
+  rowStart = vector<unsigned int>(rows + 1, 0);
+  for (unsigned int i = 0; i < rows; i++) {
+    for (unsigned int j = 0; j < clms; j++) {
+      const double mij = m(i, j);
+      if (fabs(mij) > dropTol) {
+        colNdx.push_back(j);
+        vals.push_back(mij);
+      }
+    }
+    rowStart[i + 1] = vals.size();
+  }
+}
+
+
+CSRMatrix::CSRMatrix(unsigned int nr, unsigned int nc,
+                     const vector<tuple<unsigned int, unsigned int, double>> & trpls) {
+  rows = nr;
+  clms = nc;
+  auto ts = trpls;
+  for (auto & t : ts) {
+    if ((nr <= get<0>(t)) || (nc <= get<1>(t))) {
+      throw KException("CSRMatrix::CSRMatrix: triplet index out of range");
+    }
+  }
+  auto rcBefore = [](const tuple<unsigned int, unsigned int, double> & a,
+                     const tuple<unsigned int, unsigned int, double> & b) {
+    return ((get<0>(a) < get<0>(b)) || ((get<0>(a) == get<0>(b)) && (get<1>(a) < get<1>(b))));
+  };
+  std::stable_sort(ts.begin(), ts.end(), rcBefore); // stable, so duplicates sum in input order
+
+  rowStart = vector<unsigned int>(rows + 1, 0);
+  for (unsigned int t = 0; t < ts.size(); t++) {
+    const unsigned int i = get<0>(ts[t]);
+    const unsigned int j = get<1>(ts[t]);
+    const bool dupP = (0 < t) && (i == get<0>(ts[t - 1])) && (j == get<1>(ts[t - 1]));
+    if (dupP) {
+      vals[vals.size() - 1] += get<2>(ts[t]);
+    }
+    else {
+      colNdx.push_back(j);
+      vals.push_back(get<2>(ts[t]));
+      rowStart[i + 1]++;
+    }
+  }
+  for (unsigned int i = 0; i < rows; i++) {
+    rowStart[i + 1] += rowStart[i];
+  }
+}
+
+
+CSRMatrix::~CSRMatrix() { }
+
+
+unsigned int CSRMatrix::numR() const {
+  return rows;
+}
+
+
+unsigned int CSRMatrix::numC() const {
+  return clms;
+}
+
+
+unsigned int CSRMatrix::nnz() const {
+  return vals.size();
+}
+
+
+KMatrix CSRMatrix::toDense() const {
+  auto m = KMatrix(rows, clms);
+  for (unsigned int i = 0; i < rows; i++) {
+    for (unsigned int p = rowStart[i]; p < rowStart[i + 1]; p++) {
+      m(i, colNdx[p]) = vals[p];
+    }
+  }
+  return m;
+}
+
+
+CSRMatrix CSRMatrix::plusIdentity() const {
+  if (rows != clms) {
+    throw KException("CSRMatrix::plusIdentity: matrix is not square");
+  }
+  // the identity's entry comes first, so each diagonal sums as 1 + mii, as in iMat(n) + m
+  auto trpls = vector<tuple<unsigned int, unsigned int, double>>();
+  trpls.reserve(vals.size() + rows);
+  for (unsigned int i = 0; i < rows; i++) {
+    trpls.push_back(tuple<unsigned int, unsigned int, double>(i, i, 1.0));
+    for (unsigned int p = rowStart[i]; p < rowStart[i + 1]; p++) {
+      trpls.push_back(tuple<unsigned int, unsigned int, double>(i, colNdx[p], vals[p]));
+    }
+  }
+  return CSRMatrix(rows, clms, trpls);
+}
+
+
+CSRMatrix CSRMatrix::trans() const {
+  // counting sort by column; scanning the rows in order keeps each
+  // new row's entries in column order
+  CSRMatrix t;
+  t.rows = clms;
+  t.clms = rows;
+  t.rowStart = vector<unsigned int>(clms + 1, 0);
+  for (auto j : colNdx) {
+    t.rowStart[j + 1]++;
+  }
+  for (unsigned int j = 0; j < clms; j++) {
+    t.rowStart[j + 1] += t.rowStart[j];
+  }
+  t.colNdx = vector<unsigned int>(vals.size());
+  t.vals = vector<double>(vals.size());
+  auto next = vector<unsigned int>(t.rowStart.begin(), t.rowStart.end() - 1);
+  for (unsigned int i = 0; i < rows; i++) {
+    for (unsigned int p = rowStart[i]; p < rowStart[i + 1]; p++) {
+      const unsigned int q = next[colNdx[p]]++;
+      t.colNdx[q] = i;
+      t.vals[q] = vals[p];
+    }
+  }
+  return t;
+}
+
+
+KMatrix CSRMatrix::operator*(const KMatrix & x) const {
+  if (clms != x.numR()) {
+    throw KException("CSRMatrix::operator*: matrices don't qualify for matrix multiplication");
+  }
+  const unsigned int k = x.numC();
+  auto y = KMatrix(rows, k);
+  // both are stored row by row, so walk them directly
+  auto xv = x.begin();
+  auto yv = y.begin();
+  for (unsigned int i = 0; i < rows; i++) {
+    for (unsigned int p = rowStart[i]; p < rowStart[i + 1]; p++) {
+      const double a = vals[p];
+      const unsigned int c = colNdx[p];
+      for (unsigned int j = 0; j < k; j++) {
+        yv[i*k + j] = yv[i*k + j] + a*xv[c*k + j];
+      }
+    }
+  }
+  return y;
+}
+
+
+// -------------------------------------------------
+LVISolver::LVISolver(const CSRMatrix & M, function<KMatrix(const KMatrix &)> p) {
+  if (M.numR() != M.numC()) {
+    throw KException("LVISolver::LVISolver: M must be square");
+  }
+  if (nullptr == p) {
+    throw KException("LVISolver::LVISolver: pK is a null pointer");
+  }
+  mM = M;
+  mMt = M.trans();
+  mIMt = mMt.plusIdentity();
+  pK = p;
+}
+
+
+LVISolver::~LVISolver() { }
+
+
+void LVISolver::setStart(const KMatrix & u0) {
+  uLast = u0;
+  warmP = true;
+  return;
+}
+
+
+void LVISolver::reset() {
+  uLast = KMatrix();
+  warmP = false;
+  return;
+}
+
+
+tuple<KMatrix, unsigned int, KMatrix> LVISolver::solve(const KMatrix & q, double eps, unsigned int iMax) {
+  KMatrix u0 = KMatrix(q.numR(), q.numC());
+  if (warmP && KBase::sameShape(uLast, q)) {
+    u0 = uLast;
+  }
+  auto rslt = bshe96(mM, mMt, &mIMt, q, pK, u0, eps, iMax);
+  uLast = get<0>(rslt);
+  warmP = true;
+  return rslt;
+}
+
 }; // namespace
 
 
@@ -31,6 +31,7 @@
 #include <assert.h>
 #include <functional>
 #include <tuple>
+#include <vector>
 
 #include "kutils.h"
 #include "kmatrix.h"
@@ -40,6 +41,37 @@ namespace KBase {
 
 using std::function;
 using std::tuple;
+using std::vector;
+
+// Compressed sparse row matrix, for linear VI/LCP with a large but mostly-zero M.
+// It supports just what the solvers need: products with (possibly multi-column)
+// dense matrices, and transposition. Entries within a row are in column order,
+// so a product sums in the same order as the dense product does.
+class CSRMatrix {
+public:
+  CSRMatrix();
+  // entries with |mij| <= dropTol are left out
+  explicit CSRMatrix(const KMatrix & m, double dropTol = 0.0);
+  // from (row, column, value) triplets in any order; duplicates are summed
+  CSRMatrix(unsigned int nr, unsigned int nc,
+            const vector<tuple<unsigned int, unsigned int, double>> & trpls);
+  virtual ~CSRMatrix();
+
+  unsigned int numR() const;
+  unsigned int numC() const;
+  unsigned int nnz() const;
+  KMatrix toDense() const;
+  CSRMatrix trans() const;
+  CSRMatrix plusIdentity() const; // I + this, for a square matrix
+  KMatrix operator*(const KMatrix & x) const;
+
+protected:
+  unsigned int rows = 0;
+  unsigned int clms = 0;
+  vector<unsigned int> rowStart = { 0 }; // row i is [rowStart[i], rowStart[i+1])
+  vector<unsigned int> colNdx = {};
+  vector<double> vals = {};
+};
 
 tuple<KMatrix, KMatrix, KMatrix, KMatrix> antiLemke(unsigned int n);
 
@@ -52,9 +84,40 @@ tuple<KMatrix, unsigned int, KMatrix> viABG(const KMatrix & xInit,
                                             double beta, double thresh, unsigned int iMax,
                                             bool extra);
 
+// Each column of q (and of u0) is a separate problem with the same M and K,
+// so several right-hand sides can be solved at once, sharing each pass over M.
+// A column stops changing once its own residual is within eps, so the result
+// is the same as solving it alone; pK must project each column independently.
+// The iteration count returned is that of the slowest column.
 tuple<KMatrix, unsigned int, KMatrix> viBSHe96(const KMatrix & M, const KMatrix & q,
                                                function<KMatrix(const KMatrix &)> pK,
                                                KMatrix u0, const double eps, const unsigned int iMax);
+tuple<KMatrix, unsigned int, KMatrix> viBSHe96(const CSRMatrix & M, const KMatrix & q,
+                                               function<KMatrix(const KMatrix &)> pK,
+                                               KMatrix u0, const double eps, const unsigned int iMax);
+
+// Solves a series of linear VIs with the same M and K but changing q, as in
+// a search loop, starting each from the previous solution. M is transposed
+// once, not on every solve.
+class LVISolver {
+public:
+  LVISolver(const CSRMatrix & M, function<KMatrix(const KMatrix &)> pK);
+  virtual ~LVISolver();
+
+  // starts from the last solution if it had the same shape as q, else from
+  // the start point if one was set with that shape, else from zero
+  tuple<KMatrix, unsigned int, KMatrix> solve(const KMatrix & q, double eps, unsigned int iMax);
+  void setStart(const KMatrix & u0);
+  void reset(); // forget the last solution and the start point
+
+protected:
+  CSRMatrix mM;
+  CSRMatrix mMt;
+  CSRMatrix mIMt; // I + M'
+  function<KMatrix(const KMatrix &)> pK = nullptr;
+  KMatrix uLast = KMatrix();
+  bool warmP = false;
+};
 
 }; // namespace
 
@@ -263,6 +263,171 @@ void demoThreadSynch(unsigned int n) {
     return;
 }
 
+// -------------------------------------------------
+// Seeded runs are only reproducible if the counter-based generator is
+// exactly Philox4x32-10, and if split and skipAhead address the streams
+// they claim to, so check all three.
+void demoCPRNG(uint64_t sd) {
+    using KBase::CPRNG;
+
+    LOG(INFO) << "Test Philox4x32-10 against the Random123 known-answer vectors";
+    // counter, key (low word first), expected output
+    const vector<vector<uint32_t>> kat = {
+        { 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
+          0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 },
+        { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+          0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd },
+        { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344, 0xa4093822, 0x299f31d0,
+          0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }
+    };
+    for (auto & kv : kat) {
+        uint32_t ctr[4] = { kv[0], kv[1], kv[2], kv[3] };
+        const uint64_t key = (((uint64_t)kv[5]) << 32) | kv[4];
+        CPRNG::philox(ctr, key);
+        LOG(INFO) << getFormattedString("%08x %08x %08x %08x", ctr[0], ctr[1], ctr[2], ctr[3]);
+        for (unsigned int i = 0; i < 4; i++) {
+            if (ctr[i] != kv[6 + i]) {
+              throw KException("demoCPRNG: philox does not match the known-answer vector");
+            }
+        }
+    }
+
+    LOG(INFO) << "Test CPRNG::skipAhead against a fresh stream";
+    const unsigned int nDraw = 1000;
+    auto draws = vector<uint64_t>(nDraw + 2);
+    auto c0 = CPRNG(sd);
+    for (auto & x : draws) {
+        x = c0.uniform();
+    }
+    for (unsigned int n : { 0u, 1u, 2u, 3u, 64u, 999u, nDraw }) {
+        auto c1 = CPRNG(sd);
+        c1.skipAhead(n);
+        if ((c1.uniform() != draws[n]) || (c1.getPosition() != n + 1)) {
+          throw KException("demoCPRNG: skipAhead(n) then uniform() is not draw n+1");
+        }
+        // also from the middle of a cached block
+        auto c2 = CPRNG(sd);
+        c2.uniform();
+        c2.skipAhead(n);
+        if (c2.uniform() != draws[n + 1]) {
+          throw KException("demoCPRNG: skipAhead(n) after a draw is not draw n+2");
+        }
+    }
+
+    LOG(INFO) << "Test CPRNG::split gives streams unlike each other and the parent";
+    const unsigned int nCmp = 64;
+    auto sa = CPRNG(sd).split(1);
+    auto sb = CPRNG(sd).split(2);
+    if ((sa.getKey() == sb.getKey()) || (sa.getKey() == sd) || (sb.getKey() == sd)) {
+      throw KException("demoCPRNG: split streams share a key");
+    }
+    auto ya = vector<uint64_t>(nCmp);
+    auto yb = vector<uint64_t>(nCmp);
+    for (unsigned int i = 0; i < nCmp; i++) {
+        ya[i] = sa.uniform();
+        yb[i] = sb.uniform();
+    }
+    for (unsigned int i = 0; i < nCmp; i++) {
+        for (unsigned int j = 0; j < nCmp; j++) {
+            if ((ya[i] == yb[j]) || (ya[i] == draws[j]) || (yb[i] == draws[j])) {
+              throw KException("demoCPRNG: split streams repeat each other or the parent");
+            }
+        }
+    }
+    if (CPRNG(sd).split(1).uniform() != ya[0]) {
+      throw KException("demoCPRNG: split is not repeatable");
+    }
+
+    LOG(INFO) << "CPRNG checks passed";
+    return;
+}
+
+// -------------------------------------------------
+// The bulk fills must give exactly the draws of the one-at-a-time calls,
+// as KMatrix::uniform uses them and seeded runs and regression logs depend
+// on its values.
+void demoBulkPRNG(PRNG* rng, uint64_t sd) {
+    LOG(INFO) << "Test PRNG::fillUniform and KMatrix::uniform against uniform(a,b)";
+    for (unsigned int n : { 1u, 100u, 256u, 257u, 1000u }) { // the chunk size is 256
+        auto x = vector<double>(n);
+        rng->setSeed(sd);
+        rng->fillUniform(x.data(), n, -3.0, 7.0);
+        rng->setSeed(sd);
+        auto m = KMatrix::uniform(rng, n, 1, -3.0, 7.0);
+        rng->setSeed(sd);
+        for (unsigned int i = 0; i < n; i++) {
+            const double y = rng->uniform(-3.0, 7.0);
+            if ((x[i] != y) || (m(i, 0) != y)) {
+              throw KException("demoBulkPRNG: bulk uniform draws differ from uniform(a,b)");
+            }
+        }
+        auto w = vector<uint64_t>(n);
+        rng->setSeed(sd);
+        rng->fillUniform(w.data(), n);
+        rng->setSeed(sd);
+        for (unsigned int i = 0; i < n; i++) {
+            if (w[i] != rng->uniform()) {
+              throw KException("demoBulkPRNG: fillUniform differs from uniform()");
+            }
+        }
+    }
+
+    LOG(INFO) << "Test PRNG::fillBernoulli clears the unused bits of the last word";
+    for (double p : { 0.5, 0.3 }) {
+        for (unsigned int nBits : { 1u, 63u, 64u, 100u, 1000u }) {
+            const unsigned int nWords = (nBits + 63) / 64;
+            const unsigned int tail = nBits % 64;
+            auto w = vector<uint64_t>(nWords, 0xFFFFFFFFFFFFFFFF);
+            rng->fillBernoulli(w.data(), nBits, p);
+            if ((0 < tail) && (0 != (w[nWords - 1] >> tail))) {
+              throw KException("demoBulkPRNG: fillBernoulli set bits past nBits");
+            }
+        }
+        const unsigned int nBits = 64 * 1000;
+        auto w = vector<uint64_t>(nBits / 64);
+        rng->fillBernoulli(w.data(), nBits, p);
+        unsigned int nSet = 0;
+        for (auto wi : w) {
+            for (unsigned int k = 0; k < 64; k++) {
+                nSet = nSet + ((wi >> k) & 0x1);
+            }
+        }
+        const double f = ((double)nSet) / nBits;
+        LOG(INFO) << getFormattedString("p = %.2f, observed fraction %.4f", p, f);
+        if (fabs(f - p) > 0.01) {
+          throw KException("demoBulkPRNG: fillBernoulli fraction is far from p");
+        }
+    }
+
+    LOG(INFO) << "Test PRNG::fillNormal and KMatrix::normal, with an odd count";
+    const unsigned int nNorm = 10001;
+    const double mu = 3.0;
+    const double sigma = 2.0;
+    auto z = vector<double>(nNorm);
+    rng->setSeed(sd);
+    rng->fillNormal(z.data(), nNorm, mu, sigma);
+    rng->setSeed(sd);
+    auto zm = KMatrix::normal(rng, nNorm, 1, mu, sigma);
+    double s1 = 0.0;
+    double s2 = 0.0;
+    for (unsigned int i = 0; i < nNorm; i++) {
+        if (zm(i, 0) != z[i]) {
+          throw KException("demoBulkPRNG: KMatrix::normal differs from fillNormal");
+        }
+        s1 = s1 + z[i];
+        s2 = s2 + z[i] * z[i];
+    }
+    const double zMean = s1 / nNorm;
+    const double zSD = sqrt((s2 / nNorm) - (zMean * zMean));
+    LOG(INFO) << getFormattedString("Observed mean: %+.4f, observed sd: %.4f", zMean, zSD);
+    if ((fabs(zMean - mu) > 0.1 * sigma) || (fabs(zSD - sigma) > 0.1 * sigma)) {
+      throw KException("demoBulkPRNG: fillNormal mean or sd is out of tolerance");
+    }
+
+    LOG(INFO) << "Bulk PRNG checks passed";
+    return;
+}
+
 // -------------------------------------------------
 void demoMatrix(PRNG* rng) {
 
@@ -636,6 +801,44 @@ void demoPCA(PRNG* rng) {
         showErr(w1, f1);
     }
 
+    // all the components at once, from the covariance matrix alone
+    unsigned int lzIter = 0;
+    auto ev = KBase::topEigenpairs(cvrMat, nComp, evTol, lzIter);
+    LOG(INFO) << KBase::getFormattedString("Top %u eigenvalues of the covariance, after %u Lanczos steps:",
+                                           nComp, lzIter);
+    trans(get<0>(ev)).mPrintf("%+.4f  ");
+    auto fk = trans(get<1>(ev));
+    showErr(yMat * trans(fk), fk);
+
+    // Repeated eigenvalues make the Krylov space invariant before all copies
+    // are found, so check they come out with their multiplicity, both as given
+    // and in a rotated basis.
+    LOG(INFO) << "Test topEigenpairs on repeated eigenvalues";
+    auto checkRepeated = [rng](const vector<double> & d, unsigned int k) {
+        const unsigned int n = d.size();
+        auto dMat = KMatrix(n, n);
+        for (unsigned int i = 0; i < n; i++) {
+            dMat(i, i) = d[i];
+        }
+        auto r = KMatrix::uniform(rng, n, n, -1, +1);
+        unsigned int qIter = 0;
+        auto q = get<1>(KBase::topEigenpairs(r + trans(r), n, 1E-12, qIter)); // orthogonal
+        for (auto a : { dMat, q * dMat * trans(q) }) {
+            unsigned int iter = 0;
+            auto vals = get<0>(KBase::topEigenpairs(a, k, 1E-10, iter));
+            LOG(INFO) << KBase::getFormattedString("After %u Lanczos steps:", iter);
+            trans(vals).mPrintf("%+.4f  ");
+            for (unsigned int j = 0; j < k; j++) {
+                if (fabs(vals(j, 0) - d[j]) > 1E-8) {
+                  throw KException("demoPCA: repeated eigenvalue not found");
+                }
+            }
+        }
+        return;
+    };
+    checkRepeated({ 5, 5, 1 }, 2);
+    checkRepeated({ 3, 3, 3, -1 }, 3);
+
     return;
 }
 
@@ -1014,6 +1217,89 @@ void demoAntiLemke(PRNG* rng, unsigned int n) {
 }
 
 
+// A sparse, strictly monotone LCP, solved densely, sparsely, as a batch of
+// two right-hand sides, and warm-started after a small change to q. The
+// first three must agree exactly, as the sparse products sum in the dense
+// order and batched columns freeze independently.
+void demoSparseLVI(PRNG* rng, unsigned int n) {
+    using KBase::CSRMatrix;
+    using KBase::LVISolver;
+    using std::make_tuple;
+
+    LOG(INFO) << "Construct a sparse LCP in" << n << "dimensions";
+    // M = D + A - A', with D positive diagonal and A sparse, so M is positive
+    // definite. The triplets are out of order, and D comes in two parts, to
+    // exercise the sorting and summing of the triplet constructor.
+    auto trpls = vector<tuple<unsigned int, unsigned int, double>>();
+    for (unsigned int i = n; 0 < i; i--) {
+        const unsigned int j = (i + 2) % n;
+        const double a = rng->uniform(-1.0, 1.0);
+        trpls.push_back(make_tuple(i - 1, j, a));
+        trpls.push_back(make_tuple(j, i - 1, -a));
+        trpls.push_back(make_tuple(i - 1, i - 1, 1.0));
+    }
+    for (unsigned int i = 0; i < n; i++) {
+        trpls.push_back(make_tuple(i, i, rng->uniform(0.0, 1.0)));
+    }
+    auto Ms = CSRMatrix(n, n, trpls);
+    auto M = Ms.toDense();
+    auto Md = CSRMatrix(M);
+    LOG(INFO) << getFormattedString("M has %u non-zeros of %u", Ms.nnz(), n*n);
+    if ((Md.nnz() != Ms.nnz()) || (0.0 != maxAbs(Md.toDense() - M))) {
+      throw KException("demoSparseLVI: dense and triplet CSRMatrix differ");
+    }
+
+    auto q1 = KMatrix::uniform(rng, n, 1, -10.0, +10.0);
+    auto q2 = q1 + KMatrix::uniform(rng, n, 1, -0.1, +0.1);
+    auto q12 = KMatrix(n, 2);
+    for (unsigned int i = 0; i < n; i++) {
+        q12(i, 0) = q1(i, 0);
+        q12(i, 1) = q2(i, 0);
+    }
+    const double eps = 1E-8;
+    const unsigned int iterLim = 100000;
+    auto z1 = KMatrix(n, 1);
+
+    auto rDense = viBSHe96(M, q1, KBase::projPos, z1, eps, iterLim);
+    auto rTrpl = viBSHe96(Ms, q1, KBase::projPos, z1, eps, iterLim);
+    auto rCSR = viBSHe96(Md, q1, KBase::projPos, z1, eps, iterLim);
+    auto rCold2 = viBSHe96(Ms, q2, KBase::projPos, z1, eps, iterLim);
+    auto rBatch = viBSHe96(Ms, q12, KBase::projPos, KMatrix(n, 2), eps, iterLim);
+    LOG(INFO) << getFormattedString("Dense, CSR and batched solves took %u, %u and %u iterations",
+                                    get<1>(rDense), get<1>(rTrpl), get<1>(rBatch));
+    const KMatrix u1 = get<0>(rDense);
+    const KMatrix u2 = get<0>(rCold2);
+    const KMatrix ub = get<0>(rBatch);
+    bool sameP = (get<1>(rDense) == get<1>(rTrpl)) && (get<1>(rDense) == get<1>(rCSR));
+    sameP = sameP && (0.0 == maxAbs(get<0>(rTrpl) - u1)) && (0.0 == maxAbs(get<0>(rCSR) - u1));
+    for (unsigned int i = 0; i < n; i++) {
+        sameP = sameP && (ub(i, 0) == u1(i, 0)) && (ub(i, 1) == u2(i, 0));
+    }
+    if (!sameP) {
+      throw KException("demoSparseLVI: dense, CSR and batched solutions differ");
+    }
+
+    // relative residual, as the solver measures it
+    auto relRes = [](const tuple<KMatrix, unsigned int, KMatrix> & r, const KMatrix & q) {
+        return maxAbs(get<2>(r)) / maxAbs(q);
+    };
+    auto solver = LVISolver(Ms, KBase::projPos);
+    auto rWarm1 = solver.solve(q1, eps, iterLim);
+    auto rWarm2 = solver.solve(q2, eps, iterLim);
+    LOG(INFO) << getFormattedString("LVISolver took %u iterations, then %u after perturbing q (%u cold)",
+                                    get<1>(rWarm1), get<1>(rWarm2), get<1>(rCold2));
+    LOG(INFO) << getFormattedString("Relative residuals: %.3E warm, %.3E cold",
+                                    relRes(rWarm2, q2), relRes(rCold2, q2));
+    if (0.0 != maxAbs(get<0>(rWarm1) - u1)) {
+      throw KException("demoSparseLVI: the first LVISolver solve differs from viBSHe96");
+    }
+    if ((relRes(rWarm2, q2) > eps) || (get<1>(rWarm2) > get<1>(rCold2))) {
+      throw KException("demoSparseLVI: the warm start is less accurate or slower");
+    }
+    return;
+}
+
+
 void demoEllipse(PRNG* rng) {
     unsigned int numD = 9;
     auto a = KMatrix::uniform(rng, numD, 1, 1.0, 10.0);
@@ -1119,9 +1405,8 @@ void demoGA(PRNG* rng) {
     };
 
 
-    // NOTE WELL: with multi-threading, the order of cross-over and evaluation
-    // varies from run to run, so the order of PRNG generation varies,
-    // as do the results.
+    // Each cross-over and mutation draws from its own PRNG, seeded in order
+    // from rng, so the results are the same however many threads run them.
     unsigned int pS = 50; // size of the gene pool
     double cf = 2.2; // 2.2 == everything crosses over twice, plus random 20%
     double mf = 1.5; // 1.5 == everything mutates once, plus random 50%
@@ -1135,6 +1420,7 @@ void demoGA(PRNG* rng) {
     gOpt->showGene = shFn;
     gOpt->makeGene = mgFn;
     gOpt->equiv = eqFn;
+    gOpt->hash = [](const TargetedBV* g) { return KBase::EvalCache::hash(g->bits); };
 
     auto ip = vector<TargetedBV*>();
     ip.push_back(new TargetedBV(TargetedBV::getTarget()));
@@ -1160,6 +1446,24 @@ void demoGA(PRNG* rng) {
     gOpt->show();
 
     delete gOpt;
+
+    // The same search over several islands, which evolve in parallel and
+    // pass their best genes around a ring every few generations.
+    const unsigned int numIsl = 4;
+    const unsigned int epochLen = 5;
+    const unsigned int numMigr = 2;
+    LOG(INFO) << "Island model:" << numIsl << "islands of" << pS << "genes";
+    KBase::GAIslands<TargetedBV> islands(numIsl, pS);
+    islands.cross = crFn;
+    islands.mutate = muFn;
+    islands.eval = evFn;
+    islands.showGene = shFn;
+    islands.makeGene = mgFn;
+    islands.equiv = eqFn;
+    islands.hash = [](const TargetedBV* g) { return KBase::EvalCache::hash(g->bits); };
+    islands.fill(rng);
+    islands.run(cf, mf, epochLen, numMigr, 1000, 0.2, 50, srl, iter, sIter);
+    LOG(INFO) << "Completed island run after" << iter << "generations," << sIter << "stable";
     return;
 }
 
@@ -1270,13 +1574,25 @@ void demoVHC00(uint64_t sd) {
     KMatrix pBest = get<1>(rslt);
     unsigned int in = get<2>(rslt);
     unsigned int sn = get<3>(rslt);
-    delete vhc;
-    vhc = nullptr;
     LOG(INFO) << "Iter:" << in << "Stable:" << sn;
     LOG(INFO) << getFormattedString("Best value: %+.4f", vBest);
     LOG(INFO) << "Best point:";
     trans(pBest).mPrintf(" %+.4f ");
 
+    // search again from the same point and a few random ones, concurrently
+    auto starts = vector<KMatrix> { p0 };
+    for (unsigned int k = 0; k < 3; k++) {
+        starts.push_back(KMatrix::uniform(rng, n, 1, -100, +100));
+    }
+    auto mRslt = vhc->runMulti(starts,
+                               500000, 10, 1E-10,
+                               1.0, 0.618, 1.25, 1e-8,
+                               ReportingLevel::Low);
+    LOG(INFO) << "Best multi-start point:";
+    trans(get<1>(get<1>(mRslt)[get<0>(mRslt)])).mPrintf(" %+.4f ");
+    delete vhc;
+    vhc = nullptr;
+
     // JAH 20161103 changed back to llu
     LOG(INFO) << getFormattedString("Used PRNG seed:  %020llu", sd);
     LOG(INFO) << "Target point was originally:";
@@ -2162,6 +2478,7 @@ int main(int ac, char **av) {
     unsigned int vimcpN = 0;
     bool threadP = false;
     bool uiP = false;
+    bool prngP = false;
     bool run = true;
 
     // tmp args
@@ -2194,9 +2511,12 @@ int main(int ac, char **av) {
         printf("                  0: the MCP minimize a quadratic subject to box constraints \n");
         printf("                  1: linear VI with ellipsoidal constraints \n");
         printf("                  2: Anti-Lemke linear VI \n");
+        printf("                  3: sparse, batched and warm-started linear VI \n");
         printf("\n");
         printf("--thread          several thread operations \n");
         printf("\n");
+        printf("--prng            check the random number generators \n");
+        printf("\n");
         printf("--seed <n>        set a 64bit seed \n");
         printf("                  0 means truly random \n");
         printf("                  default: %020llu \n", dSeed);
@@ -2235,6 +2555,9 @@ int main(int ac, char **av) {
             else if (strcmp(av[i], "--ui") == 0) {
                 uiP = true;
             }
+            else if (strcmp(av[i], "--prng") == 0) {
+                prngP = true;
+            }
             else if (strcmp(av[i], "--vimcp") == 0) {
                 vimcpP = true;
                 i++;
@@ -2293,6 +2616,27 @@ int main(int ac, char **av) {
       }
     }
 
+    if (prngP) {
+        try {
+          UDemo::demoCPRNG(seed);
+        }
+        catch (KException &ke) {
+          LOG(INFO) << ke.msg;
+        }
+        catch (...) {
+          LOG(INFO) << "Unknown exception from UDemo::demoCPRNG";
+        }
+        try {
+          UDemo::demoBulkPRNG(rng, seed);
+        }
+        catch (KException &ke) {
+          LOG(INFO) << ke.msg;
+        }
+        catch (...) {
+          LOG(INFO) << "Unknown exception from UDemo::demoBulkPRNG";
+        }
+    }
+
     if (matrixP) {
         rng->setSeed(seed);
         try {
@@ -2433,6 +2777,17 @@ int main(int ac, char **av) {
               LOG(INFO) << "Unknown exception from UDemo::demoAntiLemke";
             }
             break;
+        case 3:
+            try {
+              UDemo::demoSparseLVI(rng, 60);
+            }
+            catch (KException &ke) {
+              LOG(INFO) << ke.msg;
+            }
+            catch (...) {
+              LOG(INFO) << "Unknown exception from UDemo::demoSparseLVI";
+            }
+            break;
         default:
             LOG(INFO) << "Unrecognized vimcpN: " << vimcpN;
         }
@@ -0,0 +1,251 @@
+# =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+# Copyright KAPSARC. MIT Open Source License.
+# =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+#!/bin/bash
+#
+# usage: KTAB_Regression.sh [--record] [--cases <regex>]
+#                           [--ulps <n>] [--atol <x>] [--rtol <x>] [--slow <f>]
+#
+# Runs every case in regression/cases.txt and, for each one:
+# - compares its log against the golden log, number by number. A decimal
+#   number may differ by the largest of ulps units of its last printed
+#   digit, atol, and rtol*|golden|. Integers, such as iteration counts and
+#   indices, and all other text must match exactly.
+# - records wall time and peak RSS (with GNU time), plus per-phase totals
+#   for apps that write --metrics. It flags any case slower than
+#   (1+slow) times its recorded baseline.
+#
+# --record   writes this run's logs as the goldens under regression/golden,
+#            and replaces the timing baselines. It never touches the
+#            reference logs named in cases.txt; a recorded golden takes
+#            precedence over them.
+# --cases    runs only the cases whose names match the regex.
+#
+# Results go to regression/runs/<UTC time>/, with a summary.csv.
+# Exits with 42 if any case failed, like the other test scripts. A case
+# with no golden yet is reported as NO-GOLDEN but is not a failure.
+# -------------------------------------------
+
+ROOT="$(cd "$(dirname "$0")" && pwd)"
+CASES="${ROOT}/regression/cases.txt"
+GOLD="${ROOT}/regression/golden"
+OUT="${ROOT}/regression/runs/$(date --utc +%Y-%m-%d__%H-%M-%S)_GMT"
+
+record=0; only="."
+ulps=1; atol=0; rtol=0
+slow=0.15; minSlowSec=0.05  # ignore slowdowns smaller than timer noise
+
+while [ $# -gt 0 ]; do
+  case "$1" in
+    --record) record=1 ;;
+    --cases)  only="$2"; shift ;;
+    --ulps)   ulps="$2"; shift ;;
+    --atol)   atol="$2"; shift ;;
+    --rtol)   rtol="$2"; shift ;;
+    --slow)   slow="$2"; shift ;;
+    *) echo "Unrecognized argument $1"; exit 1 ;;
+  esac
+  shift
+done
+
+mkdir -p "${OUT}" "${GOLD}"
+touch "${GOLD}/timings.csv"
+
+smpFilter="Fractional change|, Pstn[0-9]+:|, prob :|There were"
+volatile="Start time|Finish time|Elapsed time|Scenario|seed|PRNG"
+errWords="assert|fail|error|except|abort|dump|segment"
+
+timeCmd=""
+if [ -x /usr/bin/time ]; then
+  timeCmd="/usr/bin/time -f %M -o"
+fi
+
+# keep only the lines worth comparing
+extract() { # <filter> <log>
+  if [ "$1" == "smp" ]; then
+    egrep "${smpFilter}" "$2"
+  else
+    egrep -v "${volatile}" "$2"
+  fi
+}
+
+# prints "<lines that differ> <largest absolute difference>"; details to $3
+numdiff() { # <golden> <run> <details>
+  awk -v ulps="${ulps}" -v atol="${atol}" -v rtol="${rtol}" -v dfile="$3" '
+    function abs(x) { return (x < 0) ? -x : x }
+    function nums(s, a,   n) {
+      n = 0
+      while (match(s, /[-+]?[0-9]+(\.[0-9]+)?([eE][-+]?[0-9]+)?/)) {
+        a[++n] = substr(s, RSTART, RLENGTH)
+        s = substr(s, RSTART + RLENGTH)
+      }
+      return n
+    }
+    function skel(s) {
+      gsub(/[-+]?[0-9]+(\.[0-9]+)?([eE][-+]?[0-9]+)?/, "#", s)
+      gsub(/[ \t]+/, " ", s)
+      return s
+    }
+    FNR == NR { g[FNR] = $0; ng = FNR; next }
+    { r[FNR] = $0; nr = FNR }
+    END {
+      bad = 0; maxd = 0
+      n = (ng > nr) ? ng : nr
+      for (i = 1; i <= n; i++) {
+        ok = (skel(g[i]) == skel(r[i]))
+        if (ok) {
+          k = nums(g[i], gv); nums(r[i], rv)
+          for (m = 1; m <= k; m++) {
+            d = abs(rv[m] - gv[m])
+            maxd = (d > maxd) ? d : maxd
+            if ((index(gv[m], ".") == 0) && (gv[m] !~ /[eE]/)) {
+              tol = 0 # integers must match exactly
+            } else {
+              lsd = (index(gv[m], ".") > 0) ? 10 ^ -(length(gv[m]) - index(gv[m], ".")) : 0
+              if (gv[m] ~ /[eE]/) { lsd = 0 }
+              tol = ulps * lsd
+              tol = (atol > tol) ? atol : tol
+              tol = (rtol * abs(gv[m]) > tol) ? rtol * abs(gv[m]) : tol
+            }
+            if (d > tol * (1 + 1e-9)) { ok = 0 } # slack for the binary rounding of d
+          }
+        }
+        if (!ok) {
+          bad++
+          printf("line %d\n- %s\n+ %s\n", i, g[i], r[i]) > dfile
+        }
+      }
+      printf("%d %g\n", bad, maxd)
+    }' "$1" "$2"
+}
+
+# total seconds in each phase, over all turns
+phases() { # <metrics csv>
+  awk -F, 'NR > 1 && $3 > 0 { t[$2] += $5 } END { for (p in t) printf("%s,%.6f\n", p, t[p]) }' "$1" | sort
+}
+
+baseline() { # <case> <column>
+  awk -F, -v c="$1" -v k="$2" '$1 == c { print $k }' "${GOLD}/timings.csv" | tail -1
+}
+
+echo "case,status,wallSec,baseSec,rssKB,baseRssKB,driftLines,maxAbsDiff,errWords" > "${OUT}/summary.csv"
+newTimes="${OUT}/timings.csv"
+: > "${newTimes}"
+testcnt=0; failcnt=0; nogoldcnt=0
+
+while IFS='|' read -r name dir log filter golden cmd; do
+  name="$(echo ${name})"
+  if [ -z "${name}" ] || [ "${name:0:1}" == "#" ]; then
+    continue
+  fi
+  if ! echo "${name}" | egrep -q "${only}"; then
+    continue
+  fi
+  dir="$(echo ${dir})"; log="$(echo ${log})"; filter="$(echo ${filter})"; golden="$(echo ${golden})"
+  # a recorded golden takes precedence over the reference log in cases.txt
+  recorded="regression/golden/${name}.txt"
+  if [ -f "${ROOT}/${recorded}" ] || [ "${golden}" == "-" ]; then
+    golden="${recorded}"
+  fi
+  testcnt=$[testcnt+1]
+  echo "Running ${name}"
+
+  metrics="${OUT}/${name}_metrics.csv"
+  cmd="${cmd//\{DB\}/regress-${name}}"
+  cmd="${cmd//\{METRICS\}/${metrics}}"
+
+  cd "${ROOT}/${dir}"
+  mkdir -p "${OUT}/stale"
+  mv ./${log}*_log.txt "${OUT}/stale/" 2> /dev/null
+
+  t0=$(date +%s.%N)
+  if [ -n "${timeCmd}" ]; then
+    eval "${timeCmd} \"${OUT}/${name}.rss\" ${cmd}" < /dev/null > "${OUT}/${name}.stdout" 2>&1
+  else
+    eval "${cmd}" < /dev/null > "${OUT}/${name}.stdout" 2>&1
+  fi
+  t1=$(date +%s.%N)
+  wall=$(awk -v a="${t0}" -v b="${t1}" 'BEGIN { printf("%.3f", b - a) }')
+  rss=$(tail -1 "${OUT}/${name}.rss" 2> /dev/null || echo NA)
+  rm -f regress-${name}*.db
+
+  cat ./${log}*_log.txt > "${OUT}/${name}_log.txt" 2> /dev/null
+  rm -f ./${log}*_log.txt
+  cd "${ROOT}"
+
+  runLog="${OUT}/${name}_log.txt"
+  extract "${filter}" "${runLog}" > "${OUT}/${name}.out"
+  errs=$(egrep -c "${errWords}" "${runLog}")
+  ends=$(grep -c "Finish time" "${runLog}")
+
+  if [ ${record} -eq 1 ]; then
+    cp "${runLog}" "${ROOT}/${recorded}"
+    golden="${recorded}"
+  fi
+
+  status="ok"
+  drift="NA"; maxd="NA"
+  if [ -f "${ROOT}/${golden}" ]; then
+    extract "${filter}" "${ROOT}/${golden}" > "${OUT}/${name}.gold"
+    read drift maxd < <(numdiff "${OUT}/${name}.gold" "${OUT}/${name}.out" "${OUT}/${name}.diff")
+    if [ "${drift}" -ne 0 ]; then
+      status="DRIFT"
+    fi
+  else
+    status="NO-GOLDEN"
+  fi
+  if [ "${errs}" -ne 0 ] || [ "${ends}" -ne 1 ]; then
+    status="ERROR"
+  fi
+
+  baseSec=$(baseline "${name}" 2)
+  baseRss=$(baseline "${name}" 3)
+  if [ "${status}" == "ok" ] && [ -n "${baseSec}" ] && [ ${record} -eq 0 ]; then
+    if awk -v w="${wall}" -v b="${baseSec}" -v s="${slow}" -v m="${minSlowSec}" \
+         'BEGIN { exit !((w > b * (1 + s)) && (w - b > m)) }'; then
+      status="SLOW"
+    fi
+  fi
+  echo "${name},${wall},${rss}" >> "${newTimes}"
+
+  if [ -f "${metrics}" ]; then
+    phases "${metrics}" > "${OUT}/${name}_phases.csv"
+    if [ ${record} -eq 1 ]; then
+      cp "${OUT}/${name}_phases.csv" "${GOLD}/${name}_phases.csv"
+    elif [ -f "${GOLD}/${name}_phases.csv" ]; then
+      # which phases account for a slowdown
+      join -t, "${GOLD}/${name}_phases.csv" "${OUT}/${name}_phases.csv" | \
+        awk -F, -v s="${slow}" -v m="${minSlowSec}" '$3 > $2 * (1 + s) && $3 - $2 > m {
+          printf("  slower phase %-20s %9.3f s -> %9.3f s\n", $1, $2, $3) }'
+    fi
+  fi
+
+  if [ "${status}" == "NO-GOLDEN" ]; then
+    nogoldcnt=$[nogoldcnt+1]
+  elif [ "${status}" != "ok" ]; then
+    failcnt=$[failcnt+1]
+  fi
+  printf "  %-10s wall %8.3f s (base %s)  rss %s KB  drift %s lines (max %s)\n" \
+    "${status}" "${wall}" "${baseSec:-NA}" "${rss}" "${drift}" "${maxd}"
+  echo "${name},${status},${wall},${baseSec:-NA},${rss},${baseRss:-NA},${drift},${maxd},${errs}" >> "${OUT}/summary.csv"
+done < "${CASES}"
+
+if [ ${record} -eq 1 ]; then
+  # keep the baselines of cases not run this time
+  awk -F, 'FNR == NR { ran[$1] = 1; print; next } !($1 in ran)' \
+    "${newTimes}" "${GOLD}/timings.csv" | sort > "${OUT}/baselines.csv"
+  cp "${OUT}/baselines.csv" "${GOLD}/timings.csv"
+fi
+
+echo "========================="
+echo "Ran ${testcnt} cases, ${failcnt} flagged, ${nogoldcnt} without a golden; see ${OUT}/summary.csv"
+if [ ${failcnt} -ne 0 ] && [ ${record} -eq 0 ]; then
+  echo "At least one test condition failed!"
+  exit 42
+fi
+echo "All test conditions passed!"
+echo "========================="
+
+# =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
+# Copyright KAPSARC. MIT Open Source License.
+# =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
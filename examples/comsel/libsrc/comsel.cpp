@@ -621,6 +621,10 @@ namespace ComSelLib {
       ghc->nghbrs = nfn;
       ghc->show = sfn;
 
+      KBase::EvalCache evalMemo;
+      ghc->hash = [](const MtchPstn mp) { return KBase::EvalCache::hash(mp.match); };
+      ghc->cache = &evalMemo;
+
       auto rslt = ghc->run(*ph, // start from h's current positions
         ReportingLevel::Silent,
         100, // iter max
@@ -596,8 +596,10 @@ void demoRMLP(PRNG* rng) {
     };
 
     if (true) {
-            LOG(INFO) << "Solve via BSHe96";
-            auto r1 = viBSHe96(matM, matQ, KBase::projPos, start, eps, iterLim);
+            // matM is mostly zeros, so use the sparse version
+            const auto spM = KBase::CSRMatrix(matM);
+            LOG(INFO) << "Solve via BSHe96, with" << spM.nnz() << "nonzeros in M";
+            auto r1 = viBSHe96(spM, matQ, KBase::projPos, start, eps, iterLim);
             auto x1 = processRslt(r1);
 
             LOG(INFO) << KBase::getFormattedString("Initial resource usage: %10.2f", rsrc0);
@@ -1076,6 +1076,11 @@ RPState* RPState::doSUSN(ReportingLevel rl) const {
     ghc->nghbrs = nghbrPerms;
     ghc->show = sfn;
 
+    // neighbors of neighbors are mostly permutations already assessed
+    KBase::EvalCache evalMemo;
+    ghc->hash = [](const MtchPstn mp) { return KBase::EvalCache::hash(mp.match); };
+    ghc->cache = &evalMemo;
+
     auto rslt = ghc->run(*ph, // start from h's current positions
                          ReportingLevel::Silent,
                          100, // iter max
@@ -6,6 +6,7 @@ RunModel::RunModel()
     // Disable all the logging to begin with
     loggerConf.set(el::Level::Global, el::ConfigurationType::Enabled, "false");
     el::Loggers::reconfigureAllLoggers(loggerConf);
+    KBase::KLog::refresh();
 }
 
 RunModel::~RunModel()
@@ -127,6 +128,7 @@ void RunModel::logSMPDataOptionsAnalysis(QString logType, QString specCount)
         // Enable all the logging
         loggerConf.set(el::Level::Global, el::ConfigurationType::Enabled, "true");
         el::Loggers::reconfigureAllLoggers(loggerConf);
+        KBase::KLog::refresh();
      }
     else if(logType=="New")
     {
@@ -144,6 +146,7 @@ void RunModel::logSMPDataOptionsAnalysis(QString logType, QString specCount)
             // Enable all the logging
             loggerConf.set(el::Level::Global, el::ConfigurationType::Enabled, "true");
             el::Loggers::reconfigureAllLoggers(loggerConf);
+            KBase::KLog::refresh();
         }
     }
     else
@@ -154,6 +157,7 @@ void RunModel::logSMPDataOptionsAnalysis(QString logType, QString specCount)
             loggerConf.set(el::Level::Global, el::ConfigurationType::Enabled, "false");
 
             el::Loggers::reconfigureAllLoggers(loggerConf);
+            KBase::KLog::refresh();
         }
     }
 }
@@ -22,6 +22,10 @@
 // -------------------------------------------------
 
 #include "database.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
 
 Database::Database()
 {
@@ -137,6 +141,8 @@ void Database::openDB(QString dbPath, QString dbType, QString connectionString,
             connectionValues = pwd.split("=");
             pwd  = connectionValues.at(1);
 
+            dbUser = uId;
+            dbPassword = pwd;
             if(!db->open(uId,pwd))
             {
                 emit Message("Database Error", db->lastError().text());
@@ -240,6 +246,7 @@ void Database::checkPostgresDB(QString connectionString, bool imp)
 void Database::getScenarioData(int turn, QString scenario,int dim)
 {
     scenarioM=scenario;
+    loadScenarioCache();
     //model parameters for current scenario
     getModelParameters();
 
@@ -293,6 +300,19 @@ void Database::getInfluenceDB(int turn)
 {
     actorInfluence.clear();
 
+    CachePtr sc = scenarioCache();
+    if(!sc.isNull())
+    {
+        for(int act = 0; (turn < sc->nTurns) && (act < sc->nActors); ++act)
+        {
+            int ndx = turn*sc->nActors + act;
+            if(sc->described[act] && !std::isnan(sc->cap[ndx]))
+                actorInfluence.append(sc->capText[ndx]);
+        }
+        emit actorsInflu(actorInfluence);
+        return;
+    }
+
     QString query= QString(" select SpatialCapability.Cap from SpatialCapability,ActorDescription where "
                            " ActorDescription.Act_i = SpatialCapability.Act_i "
                            " and SpatialCapability.ScenarioId='%1' "
@@ -314,6 +334,20 @@ void Database::getPositionDB(int dim, int turn)
 {
     actorPosition.clear();
 
+    CachePtr sc = scenarioCache();
+    if(!sc.isNull())
+    {
+        for(int act = 0; (turn < sc->nTurns) && (dim < sc->nDims) && (act < sc->nActors); ++act)
+        {
+            int ndx = (turn*sc->nActors + act)*sc->nDims + dim;
+            if(sc->described[act] && !std::isnan(sc->pos[ndx]))
+                actorPosition.append(sc->posText[ndx]);
+        }
+        if(actorPosition.length()>0)
+            emit actorsPostn(actorPosition,dim);
+        return;
+    }
+
     QString query= QString(" select VectorPosition.Pos_Coord from VectorPosition,ActorDescription where"
                            " ActorDescription.Act_i = VectorPosition.Act_i"
                            " and VectorPosition.ScenarioId='%2' "
@@ -337,6 +371,19 @@ void Database::getSalienceDB(int dim, int turn)
 {
     actorSalience.clear();
 
+    CachePtr sc = scenarioCache();
+    if(!sc.isNull())
+    {
+        for(int act = 0; (turn < sc->nTurns) && (dim < sc->nDims) && (act < sc->nActors); ++act)
+        {
+            int ndx = (turn*sc->nActors + act)*sc->nDims + dim;
+            if(sc->described[act] && !std::isnan(sc->sal[ndx]))
+                actorSalience.append(sc->salText[ndx]);
+        }
+        emit actorsSalnce(actorSalience,dim);
+        return;
+    }
+
     QString query= QString(" select SpatialSalience.Sal from SpatialSalience,ActorDescription where"
                            " ActorDescription.Act_i = SpatialSalience.Act_i"
                            " and SpatialSalience.ScenarioId='%2' "
@@ -383,44 +430,62 @@ void Database::getActorsInRangeFromDB(double lowerRng, double higherRng, int dim
     actorCapabilityList.clear();
     barData=0;
 
-    QString query= QString(" select Act_i from VectorPosition where"
-                           " Pos_Coord >= '%1'  AND Pos_Coord < '%2' AND "
-                           " Dim_k='%3' AND ScenarioId='%4' "
-                           "AND Turn_t='%5'")
-            .arg(lwr).arg(upr).arg(dim).arg(scenarioM).arg(turn);
-
-    qry->exec(query);
-
-    while(qry->next())
+    CachePtr sc = scenarioCache();
+    if(!sc.isNull())
     {
-        actorIdsList.append(qry->value(0).toInt());
+        for(int act = 0; (turn < sc->nTurns) && (dim < sc->nDims) && (act < sc->nActors); ++act)
+        {
+            int ndx = (turn*sc->nActors + act)*sc->nDims + dim;
+            double p = sc->pos[ndx];
+            if((p >= lwr) && (p < upr)) // false for NaN
+            {
+                actorIdsList.append(act);
+                actorSalienceList.append(sc->sal[ndx]);
+                actorCapabilityList.append(sc->cap[turn*sc->nActors + act]);
+            }
+        }
     }
-
-    for(int actInd =0; actInd < actorIdsList.length() ; actInd++)
+    else
     {
-        QString query= QString(" select Sal from SpatialSalience where"
-                               " Act_i = '%1' AND ScenarioId='%2' AND Turn_t='%3'"
-                               " AND Dim_k='%4'")
-                .arg(actorIdsList.at(actInd)).arg(scenarioM).arg(turn).arg(dim);
+        QString query= QString(" select Act_i from VectorPosition where"
+                               " Pos_Coord >= '%1'  AND Pos_Coord < '%2' AND "
+                               " Dim_k='%3' AND ScenarioId='%4' "
+                               "AND Turn_t='%5'")
+                .arg(lwr).arg(upr).arg(dim).arg(scenarioM).arg(turn);
 
         qry->exec(query);
 
         while(qry->next())
         {
-            actorSalienceList.append(qry->value(0).toDouble());
+            actorIdsList.append(qry->value(0).toInt());
         }
-    }
-    for(int actInd =0; actInd < actorIdsList.length() ; actInd++)
-    {
-        QString query1= QString(" select Cap from SpatialCapability where"
-                                " Act_i = '%1' AND ScenarioId='%2' AND Turn_t='%3'")
-                .arg(actorIdsList.at(actInd)).arg(scenarioM).arg(turn);
 
-        qry->exec(query1);
+        for(int actInd =0; actInd < actorIdsList.length() ; actInd++)
+        {
+            QString query= QString(" select Sal from SpatialSalience where"
+                                   " Act_i = '%1' AND ScenarioId='%2' AND Turn_t='%3'"
+                                   " AND Dim_k='%4'")
+                    .arg(actorIdsList.at(actInd)).arg(scenarioM).arg(turn).arg(dim);
+
+            qry->exec(query);
 
-        while(qry->next())
+            while(qry->next())
+            {
+                actorSalienceList.append(qry->value(0).toDouble());
+            }
+        }
+        for(int actInd =0; actInd < actorIdsList.length() ; actInd++)
         {
-            actorCapabilityList.append(qry->value(0).toDouble());
+            QString query1= QString(" select Cap from SpatialCapability where"
+                                    " Act_i = '%1' AND ScenarioId='%2' AND Turn_t='%3'")
+                    .arg(actorIdsList.at(actInd)).arg(scenarioM).arg(turn);
+
+            qry->exec(query1);
+
+            while(qry->next())
+            {
+                actorCapabilityList.append(qry->value(0).toDouble());
+            }
         }
     }
 
@@ -489,6 +554,8 @@ void Database::getUtilChlgAndSQvalues(QVector<int> VHAxisValues)
 
 void Database::releaseDB()
 {
+    cacheFuture = std::shared_future<CachePtr>();
+    cacheScenario.clear();
     if(db != nullptr) {
         if(db->open()) {
             db->close();
@@ -741,6 +808,7 @@ void Database::getScenarioList(bool run)
             //model parameters for current scenario
             getModelParameters();
         }
+        loadScenarioCache();
 
     }
     else
@@ -779,6 +847,188 @@ void Database::getModelParameters()
     else
         Message("Database","there are no/insufficient model parameters");
 }
+
+void Database::loadScenarioCache()
+{
+    if((db == nullptr) || scenarioM.isEmpty() || (cacheScenario == scenarioM))
+    {
+        return;
+    }
+    cacheScenario = scenarioM;
+
+    // the worker gets its own connection, as Qt SQL connections are per-thread
+    auto prm = std::make_shared<std::promise<CachePtr>>();
+    cacheFuture = prm->get_future().share();
+    QString driver = db->driverName();
+    QString dbPath = db->databaseName();
+    QString host = db->hostName();
+    int port = db->port();
+    QString user = dbUser;
+    QString pwd = dbPassword;
+    QString scenario = scenarioM;
+
+    // detached, so that switching scenarios never blocks on an abandoned load
+    std::thread([=]() {
+        CachePtr sc;
+        try
+        {
+            sc = readScenarioCache(driver, dbPath, host, port, user, pwd, scenario);
+        }
+        catch(...)
+        {
+            sc.reset();
+        }
+        prm->set_value(sc);
+    }).detach();
+}
+
+Database::CachePtr Database::scenarioCache()
+{
+    loadScenarioCache();
+    if(!cacheFuture.valid())
+    {
+        return CachePtr();
+    }
+    // never block the GUI thread: until the load finishes, callers query the DB directly
+    if(std::future_status::ready != cacheFuture.wait_for(std::chrono::seconds(0)))
+    {
+        return CachePtr();
+    }
+    CachePtr sc = cacheFuture.get();
+    if(sc.isNull() || (sc->scenarioId != scenarioM))
+    {
+        return CachePtr();
+    }
+    return sc;
+}
+
+Database::CachePtr Database::readScenarioCache(QString driver, QString dbPath, QString host, int port,
+                                               QString user, QString pwd, QString scenario)
+{
+    static std::atomic<int> loadNum(0);
+    QString connName = QString("guiDbCache-%1").arg(++loadNum);
+
+    struct Row { int t; int a; int k; double v; QString text; };
+    QVector<Row> posRows, salRows, capRows;
+    QVector<int> descActors;
+    bool ok = false;
+    {
+        QSqlDatabase cdb = QSqlDatabase::addDatabase(driver, connName);
+        cdb.setDatabaseName(dbPath);
+        if(!host.isEmpty())
+        {
+            cdb.setHostName(host);
+            cdb.setPort(port);
+        }
+        if(cdb.open(user, pwd))
+        {
+            QSqlQuery cq(cdb);
+            cq.setForwardOnly(true);
+
+            // one query per table for the whole scenario, rather than one per slider move
+            auto readRows = [&cq](const QString & query, QVector<Row> & rows, bool hasDim)
+            {
+                if(!cq.exec(query))
+                {
+                    return false;
+                }
+                while(cq.next())
+                {
+                    Row r;
+                    r.t = cq.value(0).toInt();
+                    r.a = cq.value(1).toInt();
+                    r.k = hasDim ? cq.value(2).toInt() : 0;
+                    const QVariant v = cq.value(hasDim ? 3 : 2);
+                    r.v = v.toDouble();
+                    r.text = v.toString();
+                    rows.append(r);
+                }
+                return true;
+            };
+
+            ok = readRows(QString("select Turn_t, Act_i, Dim_k, Pos_Coord from VectorPosition "
+                                  " where ScenarioId='%1'").arg(scenario), posRows, true)
+                    && readRows(QString("select Turn_t, Act_i, Dim_k, Sal from SpatialSalience "
+                                        " where ScenarioId='%1'").arg(scenario), salRows, true)
+                    && readRows(QString("select Turn_t, Act_i, Cap from SpatialCapability "
+                                        " where ScenarioId='%1'").arg(scenario), capRows, false);
+            if(ok && cq.exec(QString("select Act_i from ActorDescription where ScenarioId='%1'").arg(scenario)))
+            {
+                while(cq.next())
+                {
+                    descActors.append(cq.value(0).toInt());
+                }
+            }
+            else
+            {
+                ok = false;
+            }
+            cq.finish();
+            cdb.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connName);
+
+    if(!ok)
+    {
+        return CachePtr();
+    }
+
+    auto sc = new ScenarioCache();
+    sc->scenarioId = scenario;
+    for(const QVector<Row> * rows : {&posRows, &salRows, &capRows})
+    {
+        for(const Row & r : *rows)
+        {
+            if((r.t < 0) || (r.a < 0) || (r.k < 0))
+            {
+                delete sc;
+                return CachePtr();
+            }
+            sc->nTurns = qMax(sc->nTurns, r.t + 1);
+            sc->nActors = qMax(sc->nActors, r.a + 1);
+            sc->nDims = qMax(sc->nDims, r.k + 1);
+        }
+    }
+    for(int a : descActors)
+    {
+        sc->nActors = qMax(sc->nActors, a + 1);
+    }
+
+    const double nan = std::nan("");
+    const int nta = sc->nTurns * sc->nActors;
+    sc->pos.fill(nan, nta * sc->nDims);
+    sc->sal.fill(nan, nta * sc->nDims);
+    sc->cap.fill(nan, nta);
+    sc->posText.fill(QString(), nta * sc->nDims);
+    sc->salText.fill(QString(), nta * sc->nDims);
+    sc->capText.fill(QString(), nta);
+    sc->described.fill(false, sc->nActors);
+    for(const Row & r : posRows)
+    {
+        sc->pos[(r.t*sc->nActors + r.a)*sc->nDims + r.k] = r.v;
+        sc->posText[(r.t*sc->nActors + r.a)*sc->nDims + r.k] = r.text;
+    }
+    for(const Row & r : salRows)
+    {
+        sc->sal[(r.t*sc->nActors + r.a)*sc->nDims + r.k] = r.v;
+        sc->salText[(r.t*sc->nActors + r.a)*sc->nDims + r.k] = r.text;
+    }
+    for(const Row & r : capRows)
+    {
+        sc->cap[r.t*sc->nActors + r.a] = r.v;
+        sc->capText[r.t*sc->nActors + r.a] = r.text;
+    }
+    for(int a : descActors)
+    {
+        if(a >= 0)
+        {
+            sc->described[a] = true;
+        }
+    }
+    return CachePtr(sc);
+}
+
 // --------------------------------------------
 // Copyright KAPSARC. Open source MIT License.
 // --------------------------------------------
@@ -31,6 +31,8 @@
 #include <QMessageBox>
 #include <QSqlError>
 #include <QStandardItemModel>
+#include <QSharedPointer>
+#include <future>
 
 class Database : public QObject
 {
@@ -125,6 +127,38 @@ private:
     QString seedDB;
     QString scenarioM;
     QSqlQuery *qry = nullptr;
+    QString dbUser;
+    QString dbPassword;
+
+    // Positions, saliences, and capabilities of one scenario as dense arrays,
+    // so that moving the turn or dimension sliders does not query the DB.
+    // Missing values (e.g. turns without VectorPosition rows) are NaN.
+    struct ScenarioCache
+    {
+        QString scenarioId;
+        int nTurns = 0;
+        int nActors = 0;
+        int nDims = 0;
+        QVector<double> pos; // pos[(t*nActors + a)*nDims + k]
+        QVector<double> sal; // sal[(t*nActors + a)*nDims + k]
+        QVector<double> cap; // cap[t*nActors + a]
+        // the values as the DB driver formats them, so that the widgets show
+        // the same text whether or not the cache has finished loading
+        QVector<QString> posText;
+        QVector<QString> salText;
+        QVector<QString> capText;
+        QVector<bool> described; // actor a is in ActorDescription
+    };
+    using CachePtr = QSharedPointer<const ScenarioCache>;
+    std::shared_future<CachePtr> cacheFuture;
+    QString cacheScenario;
+
+    // start loading scenarioM on a background thread, if not already loaded or loading
+    void loadScenarioCache();
+    // the cache for scenarioM; null while it is still loading or if the load failed
+    CachePtr scenarioCache();
+    static CachePtr readScenarioCache(QString driver, QString dbPath, QString host, int port,
+                                      QString user, QString pwd, QString scenario);
 
     //DB to CSV
     QVector <QString> actorNameList;
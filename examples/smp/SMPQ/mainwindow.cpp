@@ -30,6 +30,7 @@ MainWindow::MainWindow()
     // Disable all the logging to begin with
     loggerConf.set(el::Level::Global, el::ConfigurationType::Enabled, "false");
     el::Loggers::reconfigureAllLoggers(loggerConf);
+    KBase::KLog::refresh();
 
     initializeCentralViewFrame();
 
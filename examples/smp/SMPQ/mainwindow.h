@@ -417,6 +417,7 @@ private slots :
 private :
     QString csvPath;
     QCheckBox * logMinimum;
+    QCheckBox * runMetrics;
     QLineEdit * seedRand;
 
     void initializeModelParametersDock();
@@ -366,6 +366,9 @@ void MainWindow::runModel(QString conStr, QString fileName)
         }
         else
         {
+            KBase::KMetrics::reset();
+            KBase::KMetrics::setEnabled(runMetrics->isChecked());
+
              currentScenarioId = QString::fromStdString(SMPLib::SMPModel::runModel
                                                        (sqlFlags,
                                                         inputDataFile.toStdString(),seed,false,parameters));
@@ -388,6 +391,21 @@ void MainWindow::runModel(QString conStr, QString fileName)
             QApplication::restoreOverrideCursor();
             statusBar()->showMessage(" Process Completed !! ");
 
+            if(runMetrics->isChecked())
+            {
+                KBase::KMetrics::setEnabled(false);
+                QString metricsFile = fileName + "_metrics.csv";
+                try
+                {
+                    KBase::KMetrics::write(metricsFile.toStdString());
+                    statusBar()->showMessage(" Process Completed !! Run metrics saved to " + metricsFile);
+                }
+                catch (KBase::KException &ke)
+                {
+                    displayMessage("Run Metrics",QString::fromStdString(ke.msg));
+                }
+            }
+
             smpDBPath(fileName);
         }
         else
@@ -454,6 +472,7 @@ void MainWindow::logSMPDataOptionsAnalysis()
         // Enable all the logging
         loggerConf.set(el::Level::Global, el::ConfigurationType::Enabled, "true");
         el::Loggers::reconfigureAllLoggers(loggerConf);
+        KBase::KLog::refresh();
     }
     else if(logNewAct->isChecked()==true)
     {
@@ -478,6 +497,7 @@ void MainWindow::logSMPDataOptionsAnalysis()
             // Enable all the logging
             loggerConf.set(el::Level::Global, el::ConfigurationType::Enabled, "true");
             el::Loggers::reconfigureAllLoggers(loggerConf);
+            KBase::KLog::refresh();
         }
     }
     else
@@ -488,6 +508,7 @@ void MainWindow::logSMPDataOptionsAnalysis()
             loggerConf.set(el::Level::Global, el::ConfigurationType::Enabled, "false");
 
             el::Loggers::reconfigureAllLoggers(loggerConf);
+            KBase::KLog::refresh();
         }
     }
 
@@ -511,6 +532,13 @@ void MainWindow::initializeModelParametersDock()
                            "\nactor positions, and position history ");
     VLayout->addWidget(logMinimum,1,0);
 
+    //Per-phase timing metrics
+    runMetrics = new QCheckBox("Record Run Metrics");
+    runMetrics->setChecked(false);
+    runMetrics->setToolTip("Checking this records per-turn phase timings and counters,"
+                           "\nsaved next to the database as <name>_metrics.csv");
+    VLayout->addWidget(runMetrics,2,0);
+
     //Seed
     //    QLabel * seedLabel = new QLabel("Randomizer Seed");
     // VLayout->addWidget(seedLabel,2,0);
@@ -519,7 +547,7 @@ void MainWindow::initializeModelParametersDock()
     seedRand->setToolTip("Set the initial seed for the random number generator;"
                          "\nif 0 is entered, the seed will be generated randomly; "
                          "\nthe model will use a default seed if this is left empty");
-    VLayout->addWidget(seedRand,2,0);
+    VLayout->addWidget(seedRand,3,0);
 
     //RUN Button
     runButton = new QPushButton;
@@ -528,7 +556,7 @@ void MainWindow::initializeModelParametersDock()
     runButton->setStyleSheet("border-style: outset; border-width: 2px;border-color: red;");
 
     runButton->setToolTip("Run the model");
-    VLayout->addWidget(runButton,3,0);
+    VLayout->addWidget(runButton,4,0);
 
     connect(runButton,SIGNAL(clicked(bool)),this,SLOT(runPushButtonClicked(bool)));
 
@@ -25,6 +25,7 @@
 //
 // --------------------------------------------
 
+#include <sstream>
 #include "smp.h"
 #include <QSqlQuery>
 #include <QVariant>
@@ -111,8 +112,12 @@ extern "C" {
 
     auto &history = md->history;
 
+    // turns released from a streamed history are reported as NaN
     auto actorPosition = [&history](uint actor, uint dim, uint state) {
       auto st = history[state];
+      if (nullptr == st) {
+        return std::nan("");
+      }
       auto pit = st->pstns[actor];
       auto vpit = static_cast<KBase::VctrPstn*>(pit);
       const double pCoord = (*vpit)(dim, 0) * 100.0; // Use the scale of [0,100]
@@ -143,6 +148,7 @@ using KBase::Actor;
 using KBase::Model;
 using KBase::Position;
 using KBase::VctrPstn;
+using KBase::KPhaseTimer;
 using KBase::BigRAdjust;
 using KBase::BigRRange;
 using KBase::VPModel;
@@ -325,7 +331,8 @@ void SMPActor::interpBrgnS2PMax(double tik, double sik, double prbI,
 
 BargainSMP* SMPActor::interpolateBrgn(const SMPActor* ai, const SMPActor* aj,
                                       const VctrPstn* posI, const VctrPstn * posJ,
-                                      double prbI, double prbJ, InterVecBrgn ivb) {
+                                      double prbI, double prbJ, InterVecBrgn ivb,
+                                      uint64_t id) {
     if ((1 != posI->numC()) || (1 != posJ->numC())) {
       throw KException("SMPActor::interpolateBrgn: position vectors posI and posJ must be column vectors");
     }
@@ -364,7 +371,7 @@ BargainSMP* SMPActor::interpolateBrgn(const SMPActor* ai, const SMPActor* aj,
         brgnJ(k, 0) = bjk;
     }
 
-    auto brgn = new BargainSMP(ai, aj, brgnI, brgnJ);
+    auto brgn = new BargainSMP(ai, aj, brgnI, brgnJ, id);
     return brgn;
 }
 
@@ -381,6 +388,7 @@ SMPState::~SMPState() {
 }
 
 void SMPState::setVDiff(const vector<VctrPstn> & vPos) {
+    KPhaseTimer tm("setVDiff");
     auto dfn = [vPos, this](unsigned int i, unsigned int j) {
         auto ai = ((const SMPActor*)(model->actrs[i]));
         KMatrix si = ai->vSal;
@@ -466,11 +474,7 @@ void SMPState::setAllAUtil(ReportingLevel rl) {
     }
 
 
-    auto vfn = [vrCoalition, &w_j, &rnUtil_ij](unsigned int k, unsigned int i, unsigned int j) {
-        double vkij = Model::vote(vrCoalition, w_j(0, k), rnUtil_ij(k, i), rnUtil_ij(k, j));
-        return vkij;
-    };
-    const auto c = Model::coalitions(vfn, na, na); // c(i,j) = strength of coaltion for i against j
+    const auto c = Model::coalitions(vrCoalition, w_j, rnUtil_ij); // c(i,j) = strength of coaltion for i against j
     const auto pv2 = Model::probCE2(model->pcem, vpmCoalition, c);
     const auto p_i = get<0>(pv2); // column
     const auto pv_ij = get<1>(pv2); // square
@@ -688,6 +692,7 @@ SMPState* SMPState::stepBCN() {
     // VectorPosition, which is in this same group, is handled separately
     if (model->sqlFlags[1])
     {
+        KPhaseTimer tm("sqlLogging");
         model->sqlPosEquiv(turn);
         model->sqlPosProb(turn);
         model->sqlPosVote(turn);
@@ -1038,6 +1043,11 @@ void SMPModel::sankeyOutput(string outputFile) const {
     if (numDim == dimName.size()) {
       throw KException("SMPModel::sankeyOutput: dimension count is in error");
     }
+    for (auto st : history) {
+        if (nullptr == st) {
+          throw KException("SMPModel::sankeyOutput: a streamed history does not hold every turn");
+        }
+    }
 
     // first prepare the header line
     char* headLine = newChars(300);
@@ -1288,14 +1298,7 @@ void SMPModel::sankeyOutput(string outputFile, string dbName, string scenarioId)
 
 // JAH 20160801 changed to refer to model sqlFlags vector to decide
 // whether or not to populate the table
-void SMPModel::showVPHistory() const {
-    if (numAct != actrs.size()) {
-      throw KException("SMPModel::showVPHistory: actor count in error");
-    }
-    if (numDim != dimName.size()) {
-      throw KException("SMPModel::showVPHistory: dimension count in error");
-    }
-
+bool SMPModel::vpLogging() const {
     // first need to get the group ID for this table
     // so then we can get the flag to populate the table or not
     // note the implicit assumption that there will never be 43+ groups :-)
@@ -1310,20 +1313,80 @@ void SMPModel::showVPHistory() const {
     }
     // be sure that it found this table
     if (grpID == 42) {
-      throw KException("SMPModel::showVPHistory: VectorPosition table wasn't found in the group of tables");
+      throw KException("SMPModel::vpLogging: VectorPosition table wasn't found in the group of tables");
     }
     if (grpID >= sqlFlags.size()) {
-      throw KException(string("SMPModel::showVPHistory: invalid group id in sqlflags: ") + std::to_string(grpID));
+      throw KException(string("SMPModel::vpLogging: invalid group id in sqlflags: ") + std::to_string(grpID));
+    }
+    return sqlFlags[grpID];
+}
+
+void SMPModel::prepareVPInsert() const {
+    string sql = "INSERT INTO VectorPosition "
+      "(ScenarioId, Turn_t, Act_i, Dim_k, Pos_Coord, Idl_Coord, Mover_BargnId)"
+      "VALUES ('" + scenId + "', :turn_t, :act_i, :dim_k, :pos_coord, :idl_coord, :mover_bgnId)";
+
+    query.prepare(QString::fromStdString(sql));
+    return;
+}
+
+// write one row of the VectorPosition table with the prepared query,
+// and return the position coordinate on the [0,100] scale
+double SMPModel::sqlVPRow(unsigned int t, unsigned int i, unsigned int k) const {
+    auto st = history[t];
+    if (nullptr == st) {
+      throw KException("SMPModel::sqlVPRow: st is a null pointer");
+    }
+    auto pit = st->pstns[i];
+    auto vpit = (const VctrPstn*)pit;
+    auto sst = ((const SMPState*)st);
+    auto vidl = sst->getIdeal(i);
+    if (1 != vpit->numC()) {
+      throw KException("SMPModel::sqlVPRow: vpit should be a column matrix");
+    }
+    if (numDim != vpit->numR()) {
+      throw KException("SMPModel::sqlVPRow: vpit should have as many rows as dimension count.");
+    }
+    const double pCoord = (*vpit)(k, 0) * 100.0; // Use the scale of [0,100]
+    query.bindValue(":turn_t", t);
+    query.bindValue(":act_i", i);
+    query.bindValue(":dim_k", k);
+    query.bindValue(":pos_coord", pCoord);
+    const double iCoord = vidl(k, 0) * 100.0; // Log at the scale of [0,100];
+    query.bindValue(":idl_coord", iCoord);
+
+    // This try block is necessary to make sure there is a bargin which caused the move
+    try {
+      query.bindValue(":mover_bgnId",  (qulonglong)(sst->getPosMoverBargain(i)));
+    }
+    catch (const std::out_of_range& oor) { // exception thrown by std::map::at() method
+      // Insert a null value
+      query.bindValue(":mover_bgnId", QVariant(QVariant::Int));
+    }
+    if (!query.exec()) {
+      LOG(INFO) << query.lastError().text().toStdString();
+      throw KException("SMPModel::sqlVPRow: Could not write into VectorPosition table");
+    }
+    return pCoord;
+}
+
+void SMPModel::showVPHistory() const {
+    if (numAct != actrs.size()) {
+      throw KException("SMPModel::showVPHistory: actor count in error");
+    }
+    if (numDim != dimName.size()) {
+      throw KException("SMPModel::showVPHistory: dimension count in error");
+    }
+    for (auto st : history) {
+        if (nullptr == st) {
+          throw KException("SMPModel::showVPHistory: a streamed history does not hold every turn");
+        }
     }
 
     // JAH 20160801 only populate the table if this group is turned on
-    if (sqlFlags[grpID])
+    if (vpLogging())
     {
-        string sql = "INSERT INTO VectorPosition "
-          "(ScenarioId, Turn_t, Act_i, Dim_k, Pos_Coord, Idl_Coord, Mover_BargnId)"
-          "VALUES ('" + scenId + "', :turn_t, :act_i, :dim_k, :pos_coord, :idl_coord, :mover_bgnId)";
-
-        query.prepare(QString::fromStdString(sql));
+        prepareVPInsert();
 
         // Prepared statements cache the execution plan for a query after the query optimizer has
         // found the best plan, so there is no big gain with simple insertions.
@@ -1340,39 +1403,9 @@ void SMPModel::showVPHistory() const {
             for (unsigned int k = 0; k < numDim; k++) {
                 actorPosHistory += actrs[i]->name + ", " + dimName[k] + ":";
                 for (unsigned int t = 0; t < history.size(); t++) {
-                    auto st = history[t];
-                    auto pit = st->pstns[i];
-                    auto vpit = (const VctrPstn*)pit;
-                    auto sst = ((const SMPState*)st);
-                    auto vidl = sst->getIdeal(i);
-                    if (1 != vpit->numC()) {
-                      throw KException("SMPModel::showVPHistory: vpit should be a column matrix");
-                    }
-                    if (numDim != vpit->numR()) {
-                      throw KException("SMPModel::showVPHistory: vpit should have as many rows as dimension count.");
-                    }
-                    const double pCoord = (*vpit)(k, 0) * 100.0; // Use the scale of [0,100]
+                    const double pCoord = sqlVPRow(t, i, k);
                     // have to print "100.0" sometimes
                     actorPosHistory += KBase::getFormattedString(" %5.1f", pCoord);
-                    query.bindValue(":turn_t", t);
-                    query.bindValue(":act_i", i);
-                    query.bindValue(":dim_k", k);
-                    query.bindValue(":pos_coord", pCoord);
-                    const double iCoord = vidl(k, 0) * 100.0; // Log at the scale of [0,100];
-                    query.bindValue(":idl_coord", iCoord);
-
-                    // This try block is necessary to make sure there is a bargin which caused the move
-                    try {
-                      query.bindValue(":mover_bgnId",  (qulonglong)(sst->getPosMoverBargain(i)));
-                    }
-                    catch (const std::out_of_range& oor) { // exception thrown by std::map::at() method
-                      // Insert a null value
-                      query.bindValue(":mover_bgnId", QVariant(QVariant::Int));
-                    }
-                    if (!query.exec()) {
-                      LOG(INFO) << query.lastError().text().toStdString();
-                      throw KException("SMPModel::showVPHistory: Could not write into VectorPosition table");
-                    }
                 }
                 LOG(INFO) << actorPosHistory;
                 actorPosHistory.clear();
@@ -1423,6 +1456,51 @@ void SMPModel::showVPHistory() const {
     return;
 }
 
+// Same records as showVPHistory, but for the single turn t, so that it can be
+// called from flushState while the history is being streamed.
+void SMPModel::showVPTurn(unsigned int t) const {
+    if (numAct != actrs.size()) {
+      throw KException("SMPModel::showVPTurn: actor count in error");
+    }
+    if (numDim != dimName.size()) {
+      throw KException("SMPModel::showVPTurn: dimension count in error");
+    }
+    auto sst = ((const SMPState*)(history[t]));
+    if (nullptr == sst) {
+      throw KException("SMPModel::showVPTurn: state is a null pointer");
+    }
+
+    if (vpLogging())
+    {
+        prepareVPInsert();
+        qtDB->transaction();
+        LOG(INFO) << KBase::getFormattedString("Actor positions at turn %u:", t);
+        string actorPos;
+        for (unsigned int i = 0; i < numAct; i++) {
+            for (unsigned int k = 0; k < numDim; k++) {
+                const double pCoord = sqlVPRow(t, i, k);
+                actorPos = actrs[i]->name + ", " + dimName[k] + ":";
+                actorPos += KBase::getFormattedString(" %5.1f", pCoord);
+                LOG(INFO) << actorPos;
+            }
+        }
+        qtDB->commit();
+    }
+
+    if (numAct != sst->aUtil.size()) { // should be fully initialized
+      throw KException("SMPModel::showVPTurn: Each actor must have a utility value");
+    }
+    auto pn = sst->pDist(-1);
+    auto pdt = std::get<0>(pn); // note that these are unique positions
+    auto unq = std::get<1>(pn);
+    LOG(INFO) << KBase::getFormattedString("Actors' winning probabilities at turn %u:", t);
+    for (unsigned int i = 0; i < numAct; i++) {
+        LOG(INFO) << actrs[i]->name + ", prob :"
+                  + KBase::getFormattedString(" %.4f", sst->posProb(i, unq, pdt));
+    }
+    return;
+}
+
 SMPModel * SMPModel::initModel(vector<string> aName, vector<string> aDesc, vector<string> dName,
                                const KMatrix & cap, // one row per actor
                                const KMatrix & pos, // one row per actor, one column per dimension
@@ -1470,6 +1548,115 @@ SMPModel * SMPModel::initModel(vector<string> aName, vector<string> aDesc, vecto
     return sm0;
 }
 
+void SMPModel::saveConfig(ostream & os) const {
+    using KBase::ckptPutU64;
+    using KBase::ckptPutDbl;
+    using KBase::ckptPutStr;
+    ckptPutU64(os, numDim);
+    for (auto dn : dimName) {
+        ckptPutStr(os, dn);
+    }
+    ckptPutDbl(os, posTol);
+    ckptPutU64(os, ((uint64_t)vrCltn));
+    ckptPutU64(os, ((uint64_t)tpCommit));
+    ckptPutU64(os, ((uint64_t)bigRAdj));
+    ckptPutU64(os, ((uint64_t)bigRRng));
+    ckptPutU64(os, ((uint64_t)ivBrgn));
+    ckptPutU64(os, ((uint64_t)brgnMod));
+    ckptPutU64(os, BargainSMP::highestBargainID);
+
+    ckptPutU64(os, numAct);
+    for (auto a : actrs) {
+        auto ai = ((const SMPActor*)a);
+        ckptPutStr(os, ai->name);
+        ckptPutStr(os, ai->desc);
+        ckptPutDbl(os, ai->sCap);
+        KBase::ckptPutMat(os, ai->vSal);
+        ckptPutU64(os, ((uint64_t)(ai->vr)));
+    }
+    return;
+}
+
+void SMPModel::loadConfig(std::istream & is) {
+    using KBase::ckptGetU64;
+    using KBase::ckptGetDbl;
+    using KBase::ckptGetStr;
+    const unsigned int nd = ((unsigned int)(ckptGetU64(is)));
+    for (unsigned int k = 0; k < nd; k++) {
+        addDim(ckptGetStr(is));
+    }
+    posTol = ckptGetDbl(is);
+    vrCltn = ((VotingRule)ckptGetU64(is));
+    tpCommit = ((ThirdPartyCommit)ckptGetU64(is));
+    bigRAdj = ((BigRAdjust)ckptGetU64(is));
+    bigRRng = ((BigRRange)ckptGetU64(is));
+    ivBrgn = ((InterVecBrgn)ckptGetU64(is));
+    brgnMod = ((SMPBargnModel)ckptGetU64(is));
+    BargainSMP::highestBargainID = ckptGetU64(is);
+
+    const unsigned int na = ((unsigned int)(ckptGetU64(is)));
+    for (unsigned int i = 0; i < na; i++) {
+        auto n = ckptGetStr(is);
+        auto d = ckptGetStr(is);
+        auto ai = new SMPActor(n, d);
+        ai->sCap = ckptGetDbl(is);
+        ai->vSal = KBase::ckptGetMat(is);
+        ai->vr = ((VotingRule)ckptGetU64(is));
+        addActor(ai);
+    }
+    return;
+}
+
+void SMPModel::saveState(ostream & os, const State * s) const {
+    using KBase::ckptPutU64;
+    using KBase::ckptPutMat;
+    auto sst = ((const SMPState*)s);
+    if (numAct != sst->pstns.size()) {
+      throw KException("SMPModel::saveState: state must have a position for each actor");
+    }
+    for (auto p : sst->pstns) {
+        ckptPutMat(os, *((const VctrPstn*)p));
+    }
+    ckptPutU64(os, sst->ideals.size());
+    for (auto & idl : sst->ideals) {
+        ckptPutMat(os, idl);
+    }
+    ckptPutMat(os, sst->accomodate);
+    ckptPutU64(os, sst->positionMovers.size());
+    for (auto & pm : sst->positionMovers) {
+        ckptPutU64(os, pm.first);
+        ckptPutU64(os, pm.second);
+    }
+    return;
+}
+
+State * SMPModel::loadState(std::istream & is) {
+    using KBase::ckptGetU64;
+    using KBase::ckptGetMat;
+    auto sst = new SMPState(this);
+    sst->step = [sst]() {
+        return sst->stepBCN();
+    };
+    for (unsigned int i = 0; i < numAct; i++) {
+        sst->pushPstn(new VctrPstn(ckptGetMat(is)));
+    }
+    const uint64_t ni = ckptGetU64(is);
+    for (uint64_t i = 0; i < ni; i++) {
+        sst->ideals.push_back(VctrPstn(ckptGetMat(is)));
+    }
+    sst->setAccomodate(ckptGetMat(is));
+    const uint64_t nm = ckptGetU64(is);
+    for (uint64_t n = 0; n < nm; n++) {
+        const unsigned int k = ((unsigned int)(ckptGetU64(is)));
+        sst->setPosMoverBargain(k, ckptGetU64(is));
+    }
+
+    // these are not saved, as they are recomputed exactly from the above
+    sst->setUENdx();
+    sst->setAUtil(-1, ReportingLevel::Silent);
+    return sst;
+}
+
 void SMPModel::displayModelParams(SMPModel *md0)
 {
     LOG(INFO) << "Model Paramaters to run the model...";
@@ -1485,7 +1672,8 @@ void SMPModel::displayModelParams(SMPModel *md0)
 }
 
 string SMPModel::runModel(vector<bool> sqlFlags,
-                          string inputDataFile, uint64_t seed, bool saveHist, vector<int> modelParams) {
+                          string inputDataFile, uint64_t seed, bool saveHist, vector<int> modelParams,
+                          unsigned int histWindow, unsigned int ckptEvery) {
     if (md0 != nullptr) {
         delete md0;
         md0 = nullptr;
@@ -1581,6 +1769,9 @@ string SMPModel::runModel(vector<bool> sqlFlags,
     }
 
     displayModelParams(md0);
+    md0->histWindow = histWindow;
+    md0->ckptEvery = ckptEvery;
+    md0->ckptFile = fileName + ".ckpt";
 
     auto cleanup = [] {
       md0->releaseDB();
@@ -1594,7 +1785,13 @@ string SMPModel::runModel(vector<bool> sqlFlags,
 
       md0->releaseDB();
       if (saveHist) {
-        md0->sankeyOutput(fileName);
+        if (0 < md0->histWindow) {
+          // the full history was not kept in memory, so it has to come from the DB
+          LOG(INFO) << "Streamed history: use sankeyOutput with the DB to save the history";
+        }
+        else {
+          md0->sankeyOutput(fileName);
+        }
       }
     }
     catch (KException &ke) {
@@ -1627,6 +1824,137 @@ string SMPModel::runModel(vector<bool> sqlFlags,
     return md0->getScenarioID();
 }
 
+string SMPModel::resumeModel(vector<bool> sqlFlags, string ckptFile,
+                             unsigned int histWindow, unsigned int ckptEvery) {
+    if (md0 != nullptr) {
+        delete md0;
+        md0 = nullptr;
+    }
+
+    auto cleanup = [] {
+      if (nullptr != md0) {
+        md0->releaseDB();
+        delete md0;
+        md0 = nullptr;
+      }
+    };
+
+    try {
+      // the scenario, seed, and PRNG state are all replaced by those in the checkpoint
+      md0 = new SMPModel("", KBase::dSeed, sqlFlags, "");
+      md0->loadCheckpoint(ckptFile);
+      md0->sqlTest();
+      displayModelParams(md0);
+      md0->histWindow = histWindow;
+      md0->ckptEvery = ckptEvery;
+      md0->ckptFile = ckptFile;
+
+      configExec(md0);
+      md0->releaseDB();
+    }
+    catch (KException &ke) {
+      lastExceptionMsg = ke.msg;
+      LOG(INFO) << lastExceptionMsg;
+      cleanup();
+      return "";
+    }
+    catch (std::exception &std_ex) {
+      lastExceptionMsg = std_ex.what();
+      LOG(INFO) << lastExceptionMsg;
+      cleanup();
+      return "";
+    }
+    catch (...) {
+      lastExceptionMsg = "SMPModel::resumeModel: Unknown Exception Caught";
+      LOG(INFO) << lastExceptionMsg;
+      cleanup();
+      return "";
+    }
+    return md0->getScenarioID();
+}
+
+SMPModel * SMPModel::branch(const SMPModel * parent, unsigned int t,
+                             function<void(SMPModel *)> mutate) {
+    if (nullptr == parent) {
+      throw KException("SMPModel::branch: parent is a null pointer");
+    }
+    if (t >= parent->history.size()) {
+      throw KException("SMPModel::branch: parent has no state at the given turn");
+    }
+    if (nullptr == parent->history[t]) {
+      throw KException("SMPModel::branch: parent no longer holds the given turn in memory");
+    }
+
+    // copy just what is needed to continue from turn t
+    std::stringstream ss;
+    parent->writeCheckpoint(ss, t);
+
+    auto br = new SMPModel("", parent->rngSeed, parent->sqlFlags, "");
+    const string brId = br->scenId;
+    br->readCheckpoint(ss);
+    br->scenId = brId;
+    br->scenName = KBase::getFormattedString("%s-t%u", parent->scenName.c_str(), t);
+    br->scenDesc = KBase::getFormattedString("Branch at turn %u of scenario %s",
+                   t, parent->scenId.c_str());
+    br->histFlushed = t; // earlier turns were recorded under the parent's scenario
+    // turns 2 to t-1 are not copied, so the branch must stream its history and
+    // its post-run reports must use only what flushState wrote per turn
+    br->histWindow = (2 < parent->histWindow) ? parent->histWindow : 2;
+
+    if (nullptr != mutate) {
+        mutate(br);
+    }
+
+    // capabilities or saliences may have changed, so the utilities must be recomputed
+    for (auto s : br->history) {
+        if (nullptr != s) {
+            s->aUtil = {};
+            s->setAUtil(-1, ReportingLevel::Silent);
+        }
+    }
+    LOG(INFO) << "Branched scenario" << br->scenId << "from" << parent->scenId << "at turn" << t;
+    return br;
+}
+
+vector<string> SMPModel::runBranches(const vector<SMPModel *> & branches, unsigned int numPar) {
+    const unsigned int nb = branches.size();
+    auto ids = vector<string>(nb, "");
+    if (0 == nb) {
+        return ids;
+    }
+    if (0 == dbDriver.compare("QSQLITE")) {
+        numPar = 1;
+    }
+
+    auto errs = vector<string>(nb, "");
+    auto runOne = [&branches, &ids, &errs](unsigned int b) {
+        SMPModel * br = branches[b];
+        try {
+            // each thread needs its own DB connection
+            br->sqlTest(QString::fromStdString("smpDB-" + br->scenId));
+            configExec(br);
+            br->releaseDB();
+            ids[b] = br->scenId;
+        }
+        catch (KException &ke) {
+            errs[b] = ke.msg;
+        }
+        catch (std::exception &std_ex) {
+            errs[b] = std_ex.what();
+        }
+        return;
+    };
+    KBase::groupThreads(runOne, 0, nb - 1, numPar);
+
+    for (unsigned int b = 0; b < nb; b++) {
+        if (0 < errs[b].length()) {
+            throw KException(KBase::getFormattedString("SMPModel::runBranches: branch %u failed: %s",
+                             b, errs[b].c_str()));
+        }
+    }
+    return ids;
+}
+
 string SMPModel::csvReadExec(uint64_t seed, string inputCSV, vector<bool> f, vector<int> par) {
     if (md0 != nullptr) {
         delete md0;
@@ -1672,6 +2000,29 @@ void SMPModel::configExec(SMPModel * md0)
     // Drop the indices of the tables before the model run
     md0->dropTableIndices();
 
+    // A resumed run holds only a few of the turns before its checkpoint, so it always streams.
+    // So does a checkpointed run, so that every turn before a checkpoint is recorded
+    // when the checkpoint is saved, and an interrupted run loses none of them.
+    if (((1 < md0->history.size()) || (0 < md0->ckptEvery)) && (0 == md0->histWindow)) {
+        md0->histWindow = 2;
+    }
+
+    // When streaming, each turn's PosUtil and VectorPosition records are written
+    // as soon as the state is done, instead of after the run.
+    const bool streamP = (0 < md0->histWindow);
+    if (streamP) {
+        md0->flushState = [md0](unsigned int t, const State *) {
+            if (md0->sqlFlags[0]) {
+                md0->sqlCapSal(t);
+            }
+            if (md0->sqlFlags[4]) {
+                md0->sqlAUtil(t);
+            }
+            md0->showVPTurn(t);
+            return;
+        };
+    }
+
     // execute
     LOG(INFO) << "Starting model run";
     md0->run();
@@ -1683,9 +2034,14 @@ void SMPModel::configExec(SMPModel * md0)
     if (md0->sqlFlags[0])
     {
         md0->LogInfoTables();
+        if (!streamP) {
+            for (unsigned int turn = 0; turn < nState; ++turn) {
+                md0->sqlCapSal(turn);
+            }
+        }
     }
 
-    if (md0->sqlFlags[4]) {
+    if (md0->sqlFlags[4] && !streamP) {
         for (auto turn = 0; turn < nState; ++turn) {
             md0->sqlAUtil(turn);
         }
@@ -1703,7 +2059,9 @@ void SMPModel::configExec(SMPModel * md0)
     LOG(INFO) << "Completed model run";
     LOG(INFO) << KBase::getFormattedString(
       "There were %u states, with %i steps between them", nState, nState - 1);
-    md0->showVPHistory();
+    if (!streamP) {
+        md0->showVPHistory();
+    }
 
     //Create indices in the tables
     md0->createTableIndices();
@@ -1744,94 +2102,111 @@ vector<int> SMPModel::getDefaultModelParameters()
     return defaultParameters;
 }
 
-double SMPModel::getQuadMapPoint(size_t t, size_t est_h, size_t aff_k, size_t init_i, size_t rcvr_j) {
-    auto smpState = md0->history[t];
-    auto autil = smpState->aUtil;
-    double uii = autil[est_h](init_i, init_i);
-    double uij = autil[est_h](init_i, rcvr_j);
-    double uji = autil[est_h](rcvr_j, init_i);
-    double ujj = autil[est_h](rcvr_j, rcvr_j);
+QuadMapGrid::QuadMapGrid(unsigned int na, const vector<double> & u, const vector<double> & s,
+                         const vector<double> & c, VotingRule vr, ThirdPartyCommit tpc,
+                         unsigned int numPar) : numAct(na) {
+    if ((na*na*na != u.size()) || (na != s.size()) || (na != c.size())) {
+      throw KException("QuadMapGrid::QuadMapGrid: data sizes do not match the number of actors");
+    }
+    utils = u;
+    sals = s;
+    pVict = vector<double>(na*na*na, 0.0);
+
+    // the weight of each actor in the coalitions is salience times capability
+    auto w = vector<double>(na, 0.0);
+    for (unsigned int n = 0; n < na; n++) {
+        w[n] = s[n] * c[n];
+    }
+
+    // h's estimate that i beats j, or NaN where getQuadMapPoint would have thrown
+    auto hVict = [this, na, &w, vr, tpc](unsigned int h, unsigned int i, unsigned int j) {
+        auto contribs = SMPModel::calcContribs(vr, w[i], w[j], tuple<double, double, double, double>(
+            util(h, i, i), util(h, i, j), util(h, j, i), util(h, j, j)));
+        double chij = get<0>(contribs); // strength of complete coalition supporting i over j
+        double chji = get<1>(contribs); // strength of complete coalition supporting j over i
+        const double contrib_i_ij = chij;
+        const double contrib_j_ij = chji;
+        for (unsigned int n = 0; n < na; n++) {
+            if ((n != i) && (n != j)) { // already got their influence-contributions
+                const double uni = util(h, n, i);
+                const double unj = util(h, n, j);
+                const double unn = util(h, n, n);
+                const double pin = Actor::vProbLittle(vr, w[n], uni, unj, contrib_i_ij, contrib_j_ij);
+                if ((0.0 > pin) || (pin > 1.0)) {
+                    return std::nan("");
+                }
+                auto vt_uv_ul = Actor::thirdPartyVoteSU(w[n], vr, tpc, pin, 1.0 - pin, uni, unj, unn);
+                const double vnij = get<0>(vt_uv_ul);
+                chij = (vnij > 0) ? (chij + vnij) : chij;
+                chji = (vnij < 0) ? (chji - vnij) : chji;
+                if ((0 >= chij) || (0 >= chji)) {
+                    return std::nan("");
+                }
+            }
+        }
+        return chij / (chij + chji);
+    };
+
+    // each estimator h fills a disjoint slice of pVict
+    auto errs = vector<string>(na, "");
+    auto fillH = [this, na, &hVict, &errs](unsigned int h) {
+        try {
+            for (unsigned int i = 0; i < na; i++) {
+                for (unsigned int j = 0; j < na; j++) {
+                    pVict[(h*na + i)*na + j] = hVict(h, i, j);
+                }
+            }
+        }
+        catch (KException &ke) {
+            errs[h] = ke.msg;
+        }
+        return;
+    };
+    KBase::groupThreads(fillH, 0, na - 1, numPar);
+    for (auto & e : errs) {
+        if (0 < e.length()) {
+            throw KException(e);
+        }
+    }
+}
+
+double QuadMapGrid::point(unsigned int h, unsigned int k, unsigned int i, unsigned int j) const {
+    if ((h >= numAct) || (k >= numAct) || (i >= numAct) || (j >= numAct)) {
+      throw KException("QuadMapGrid::point: actor index out of range");
+    }
 
     // h's estimate of utility to k of status-quo positions of i and j
-    const double euSQ = autil[est_h](aff_k, init_i) + autil[est_h](aff_k, rcvr_j);
+    const double euSQ = util(h, k, i) + util(h, k, j);
     if ((0.0 > euSQ) || (euSQ > 2.0)) {
-      throw KException("SMPModel::getQuadMapPoint: euSQ should be between 0.0 and 2.0");
+      throw KException("QuadMapGrid::point: euSQ should be between 0.0 and 2.0");
     }
 
     // h's estimate of utility to k of i defeating j, so j adopts i's position
-    const double uhkij = autil[est_h](aff_k, init_i) + autil[est_h](aff_k, init_i);
+    const double uhkij = 2 * util(h, k, i);
     if ((0.0 > uhkij) || (uhkij > 2.0)) {
-      throw KException("SMPModel::getQuadMapPoint: uhkij should be between 0.0 and 2.0");
+      throw KException("QuadMapGrid::point: uhkij should be between 0.0 and 2.0");
     }
 
     // h's estimate of utility to k of j defeating i, so i adopts j's position
-    const double uhkji = autil[est_h](aff_k, rcvr_j) + autil[est_h](aff_k, rcvr_j);
+    const double uhkji = 2 * util(h, k, j);
     if ((0.0 > uhkji) || (uhkji > 2.0)) {
-      throw KException("SMPModel::getQuadMapPoint: uhkji should be between 0.0 and 2.0");
+      throw KException("QuadMapGrid::point: uhkji should be between 0.0 and 2.0");
     }
 
-    auto ai = ((const SMPActor*)(md0->actrs[init_i]));
-    double si = KBase::sum(ai->vSal);
+    const double si = sals[i];
     if ((0 >= si) || (si > 1)) {
-      throw KException("SMPModel::getQuadMapPoint: si should be between 0 and 1");
+      throw KException("QuadMapGrid::point: si should be between 0 and 1");
     }
-    double ci = ai->sCap;
-    auto aj = ((const SMPActor*)(md0->actrs[rcvr_j]));
-    double sj = KBase::sum(aj->vSal);
+    const double sj = sals[j];
     if ((0 >= sj) || (sj > 1)) {
-      throw KException("SMPModel::getQuadMapPoint: sj should be between 0 and 1");
+      throw KException("QuadMapGrid::point: sj should be between 0 and 1");
     }
-    double cj = aj->sCap;
-    const double minCltn = 1E-10;
 
-    auto contribs = calcContribs(md0->vrCltn, si*ci, sj*cj, tuple<double, double, double, double>(uii, uij, uji, ujj));
-
-    double chij = get<0>(contribs); // strength of complete coalition supporting i over j (initially empty)
-    double chji = get<1>(contribs); // strength of complete coalition supporting j over i (initially empty)
-
-    // cache those sums
-    double contrib_i_ij = chij;
-    double contrib_j_ij = chji;
-
-    // we assess the overall coalition strengths by adding up the contribution of
-    // individual actors (including i and j, above). We assess the contribution of third
-    // parties (n) by looking at little coalitions in the hypothetical (in:j) or (i:nj) contests.
-    for (unsigned int n = 0; n < md0->numAct; n++) {
-        if ((n != init_i) && (n != rcvr_j)) { // already got their influence-contributions
-            auto an = ((const SMPActor*)(md0->actrs[n]));
-
-            double cn = an->sCap;
-            double sn = KBase::sum(an->vSal);
-            double uni = autil[est_h](n, init_i);
-            double unj = autil[est_h](n, rcvr_j);
-            double unn = autil[est_h](n, n);
-
-            // notice that each third party starts afresh,
-            // considering only contributions of principals and itself
-            double pin = Actor::vProbLittle(md0->vrCltn, sn*cn, uni, unj, contrib_i_ij, contrib_j_ij);
-
-            if (0.0 > pin) {
-              throw KException("SMPModel::getQuadMapPoint: pin must be non-negative");
-            }
-            if (pin > 1.0) {
-              throw KException("SMPModel::getQuadMapPoint: pin must not be more than 1.0");
-            }
-            double pjn = 1.0 - pin;
-            auto vt_uv_ul = Actor::thirdPartyVoteSU(sn*cn, md0->vrCltn, md0->tpCommit, pin, pjn, uni, unj, unn);
-            const double vnij = get<0>(vt_uv_ul);
-            chij = (vnij > 0) ? (chij + vnij) : chij;
-            if (0 >= chij) {
-              throw KException("SMPModel::getQuadMapPoint: chij must be positive");
-            }
-            chji = (vnij < 0) ? (chji - vnij) : chji;
-            if (0 >= chji) {
-              throw KException("SMPModel::getQuadMapPoint: chij must be positive");
-            }
-        }
+    const double phij = pVict[(h*numAct + i)*numAct + j]; // ProbVict, for i
+    if (std::isnan(phij)) {
+      throw KException("QuadMapGrid::point: coalition strengths for (i:j) are invalid");
     }
-
-    const double phij = chij / (chij + chji); // ProbVict, for i
-    const double phji = chji / (chij + chji);
+    const double phji = 1.0 - phij;
 
     const double euVict = uhkij;  // UtilVict
     const double euCntst = phij*uhkij + phji*uhkji; // UtilContest,
@@ -1840,187 +2215,153 @@ double SMPModel::getQuadMapPoint(size_t t, size_t est_h, size_t aff_k, size_t in
     return (euChlg - euSQ);
 }
 
-double SMPModel::getQuadMapPoint(const QString &connectionName, const string &scenarioID,
-  size_t turn, size_t est_h, size_t aff_k, size_t init_i, size_t rcvr_j) {
-
-  QSqlDatabase qdb = QSqlDatabase::database(connectionName);
-  QSqlQuery qtQry = QSqlQuery(qdb);;
-
-    auto getUtilQuery = [scenarioID, turn, est_h](size_t initiator, size_t receiver) {
-        string query = "SELECT Util FROM PosUtil WHERE ScenarioId = \'" + scenarioID
-                + "\' AND Turn_t = " + std::to_string(turn) + " AND Est_h = " + std::to_string(est_h)
-                + " AND Act_i = " + std::to_string(initiator) + " AND Pos_j =  " + std::to_string(receiver);
-        return query;
-    };
-
-    auto getVSalQuery = [scenarioID, turn](size_t actor) {
-        string query = "SELECT SUM(Sal) FROM SpatialSalience WHERE ScenarioId=\'" + scenarioID
-                + "\' AND Turn_t = " + std::to_string(turn) + " AND Act_i = " + std::to_string(actor);
-
-        return query;
-    };
-
-    auto getSCapQuery = [scenarioID, turn](size_t actor) {
-        string query = "SELECT Cap FROM SpatialCapability WHERE ScenarioId=\'" + scenarioID
-                + "\' AND Turn_t = " + std::to_string(turn) + " AND Act_i = " + std::to_string(actor);
+// The quad map dock asks for one point at a time, so keep each turn's grid
+static std::mutex quadMapCacheLock;
+static std::map<string, shared_ptr<const QuadMapGrid>> quadMapCache;
+static const unsigned int maxQuadMapGrids = 64; // about 2MB each for 50 actors
 
-        return query;
-    };
-
-    // Get voting rule and third party commit for this scenario
-    string query = "SELECT VotingRule, ThirdPartyCommit FROM ScenarioDesc WHERE ScenarioId=\'" + scenarioID + "\'";
-
-    //voting rule
-    int vr;
-    //third party commit
-    int tpc;
-    if (qtQry.exec(query.c_str())) {
-      if (qtQry.first()) {
-        vr = qtQry.value(0).toInt();
-        tpc = qtQry.value(1).toInt();
-      }
-    }
-
-    VotingRule vrCltn = static_cast<VotingRule>(vr);
-    ThirdPartyCommit tpCommit = static_cast<ThirdPartyCommit>(tpc);
-
-    auto getData = [&qtQry]() {
-      if (qtQry.exec()) {
-        if (qtQry.first()) {
-          return qtQry.value(0);
+static shared_ptr<const QuadMapGrid> cachedQuadMapGrid(const string & key,
+        function<shared_ptr<const QuadMapGrid>()> build) {
+    {
+        std::lock_guard<std::mutex> lk(quadMapCacheLock);
+        auto it = quadMapCache.find(key);
+        if (quadMapCache.end() != it) {
+            return it->second;
         }
-      }
-    };
-
-    auto utilValue = [&qtQry, &getData](size_t initiator, size_t receiver) {
-      qtQry.bindValue(":act_i", (uint)initiator);
-      qtQry.bindValue(":pos_j", (uint)receiver);
-      return getData().toDouble();
-    };
-
-    auto spatialValue = [&qtQry, &getData](size_t initiator) {
-      qtQry.bindValue(":act_i", (uint)initiator);
-      return getData().toDouble();
-    };
-
-    string utilQry = "SELECT Util FROM PosUtil WHERE ScenarioId = \'" + scenarioID
-      + "\' AND Turn_t = " + std::to_string(turn) + " AND Est_h = " + std::to_string(est_h)
-      + " AND Act_i = :act_i AND Pos_j = :pos_j";
-
-    qtQry.prepare(utilQry.c_str());
-
-    double uii = utilValue(init_i, init_i);
-
-    double uij = utilValue(init_i, rcvr_j);
-
-    double uji = utilValue(rcvr_j, init_i);
-
-    double ujj = utilValue(rcvr_j, rcvr_j);
-
-    double uki = utilValue(aff_k, init_i);
-
-    double ukj = utilValue(aff_k, rcvr_j);
-
-    double euSQ = uki + ukj;
-
-    double uhkij = 2 * uki;
-    if ((0.0 > uhkij) || (uhkij > 2.0)) {
-      throw KException("SMPModel::getQuadMapPoint: uhkij should be between 0.0 and 2.0");
     }
-
-    double uhkji = 2 * ukj;
-    if ((0.0 > uhkji) || (uhkji > 2.0)) {
-      throw KException("SMPModel::getQuadMapPoint: uhkji should be between 0.0 and 2.0");
+    auto grid = build(); // built outside the lock, as it can be slow
+    std::lock_guard<std::mutex> lk(quadMapCacheLock);
+    if (maxQuadMapGrids <= quadMapCache.size()) {
+        quadMapCache.clear(); // crude, but the dock mostly revisits a few recent turns
     }
+    quadMapCache[key] = grid;
+    return grid;
+}
 
-    string vsalQry = "SELECT SUM(Sal) FROM SpatialSalience WHERE ScenarioId=\'" + scenarioID
-      + "\' AND Turn_t = " + std::to_string(turn) + " AND Act_i = :act_i";
-    qtQry.prepare(vsalQry.c_str());
+void SMPModel::clearQuadMapCache() {
+    std::lock_guard<std::mutex> lk(quadMapCacheLock);
+    quadMapCache.clear();
+    return;
+}
 
-    double si = spatialValue(init_i);
-    if ((0 >= si) || (si > 1)) {
-      throw KException("SMPModel::getQuadMapPoint: si should be between 0 and 1");
+shared_ptr<const QuadMapGrid> SMPModel::getQuadMapGrid(size_t t, unsigned int numPar) {
+    if (nullptr == md0) {
+      throw KException("SMPModel::getQuadMapGrid: there is no model");
     }
-
-    double sj = spatialValue(rcvr_j);
-    if ((0 >= sj) || (sj > 1)) {
-      throw KException("SMPModel::getQuadMapPoint: sj should be between 0 and 1");
+    if ((t >= md0->history.size()) || (nullptr == md0->history[t])) {
+      throw KException("SMPModel::getQuadMapGrid: the model does not hold that turn");
     }
+    const string key = md0->scenId + "/" + std::to_string(t);
+    auto build = [t, numPar]() {
+        const unsigned int na = md0->numAct;
+        auto smpState = md0->history[t];
+        if (na != smpState->aUtil.size()) {
+          throw KException("SMPModel::getQuadMapGrid: Each actor must have a utility value");
+        }
+        auto u = vector<double>(na*na*na, 0.0);
+        for (unsigned int h = 0; h < na; h++) {
+            const KMatrix & uh = smpState->aUtil[h];
+            for (unsigned int a = 0; a < na; a++) {
+                for (unsigned int p = 0; p < na; p++) {
+                    u[(h*na + a)*na + p] = uh(a, p);
+                }
+            }
+        }
+        auto s = vector<double>(na, 0.0);
+        auto c = vector<double>(na, 0.0);
+        for (unsigned int n = 0; n < na; n++) {
+            auto an = ((const SMPActor*)(md0->actrs[n]));
+            s[n] = KBase::sum(an->vSal);
+            c[n] = an->sCap;
+        }
+        return shared_ptr<const QuadMapGrid>(
+            new QuadMapGrid(na, u, s, c, md0->vrCltn, md0->tpCommit, numPar));
+    };
+    return cachedQuadMapGrid(key, build);
+}
 
-    string scapQry = "SELECT Cap FROM SpatialCapability WHERE ScenarioId=\'" + scenarioID
-      + "\' AND Turn_t = " + std::to_string(turn) + " AND Act_i = :act_i";
-    qtQry.prepare(scapQry.c_str());
-
-    double ci = spatialValue(init_i);
-
-    double cj = spatialValue(rcvr_j);
-
-    auto contribs = calcContribs(vrCltn, si*ci, sj*cj, tuple<double, double, double, double>(uii, uij, uji, ujj));
-
-    double chij = get<0>(contribs); // strength of complete coalition supporting i over j (initially empty)
-    double chji = get<1>(contribs); // strength of complete coalition supporting j over i (initially empty)
-
-    // cache those sums
-    double contrib_i_ij = chij;
-    double contrib_j_ij = chji;
-
-    // Get count of actors for this scenario
-    query = "SELECT MAX(Act_i) FROM ActorDescription WHERE ScenarioId=\'" + scenarioID + "\'";
-    qtQry.prepare(query.c_str());
-    size_t numAct = getData().toUInt() + 1;
-
-    // we assess the overall coalition strengths by adding up the contribution of
-    // individual actors (including i and j, above). We assess the contribution of third
-    // parties (n) by looking at little coalitions in the hypothetical (in:j) or (i:nj) contests.
-    //for (size_t n = 0; n < numAct; n++) {
-    for (size_t n = 0; n < numAct; n++) {
-      if ((n != init_i) && (n != rcvr_j)) { // already got their influence-contributions
-
-            qtQry.prepare(vsalQry.c_str());
-            double sn = spatialValue(n);
-
-            qtQry.prepare(scapQry.c_str());
-            double cn = spatialValue(n);
-
-            qtQry.prepare(utilQry.c_str());
-            double uni = utilValue(n, init_i);
-
-            double unj = utilValue(n, rcvr_j);
-
-            double unn = utilValue(n, n);
+shared_ptr<const QuadMapGrid> SMPModel::getQuadMapGrid(const QString &connectionName,
+        const string &scenarioID, size_t turn, unsigned int numPar) {
+    const string key = connectionName.toStdString() + "/" + scenarioID + "/" + std::to_string(turn);
+    auto build = [connectionName, scenarioID, turn, numPar]() {
+        QSqlDatabase qdb = QSqlDatabase::database(connectionName);
+        QSqlQuery qtQry = QSqlQuery(qdb);
+        const string scenTurn = " WHERE ScenarioId = \'" + scenarioID
+          + "\' AND Turn_t = " + std::to_string(turn);
+
+        // Get voting rule and third party commit for this scenario
+        string query = "SELECT VotingRule, ThirdPartyCommit FROM ScenarioDesc WHERE ScenarioId=\'" + scenarioID + "\'";
+        if (!(qtQry.exec(query.c_str()) && qtQry.first())) {
+          throw KException("SMPModel::getQuadMapGrid: scenario not found");
+        }
+        const VotingRule vrCltn = static_cast<VotingRule>(qtQry.value(0).toInt());
+        const ThirdPartyCommit tpCommit = static_cast<ThirdPartyCommit>(qtQry.value(1).toInt());
 
-            // notice that each third party starts afresh,
-            // considering only contributions of principals and itself
-            double pin = Actor::vProbLittle(vrCltn, sn*cn, uni, unj, contrib_i_ij, contrib_j_ij);
+        // Get count of actors for this scenario
+        query = "SELECT MAX(Act_i) FROM ActorDescription WHERE ScenarioId=\'" + scenarioID + "\'";
+        if (!(qtQry.exec(query.c_str()) && qtQry.first())) {
+          throw KException("SMPModel::getQuadMapGrid: actors not found");
+        }
+        const unsigned int na = qtQry.value(0).toUInt() + 1;
 
-            if (0.0 > pin || pin > 1.0) {
-              throw KException("SMPModel::getQuadMapPoint: pin should be between 0 and 1");
-            }
-            double pjn = 1.0 - pin;
-            auto vt_uv_ul = Actor::thirdPartyVoteSU(sn*cn, vrCltn, tpCommit, pin, pjn, uni, unj, unn);
-            const double vnij = get<0>(vt_uv_ul);
-            chij = (vnij > 0) ? (chij + vnij) : chij;
-            if (0 >= chij) {
-              throw KException("SMPModel::getQuadMapPoint: chij must be positive");
+        // the whole turn in one query per table
+        auto u = vector<double>(na*na*na, 0.0);
+        query = "SELECT Est_h, Act_i, Pos_j, Util FROM PosUtil" + scenTurn;
+        if (!qtQry.exec(query.c_str())) {
+          throw KException("SMPModel::getQuadMapGrid: could not read PosUtil");
+        }
+        unsigned int nRows = 0;
+        while (qtQry.next()) {
+            const unsigned int h = qtQry.value(0).toUInt();
+            const unsigned int a = qtQry.value(1).toUInt();
+            const unsigned int p = qtQry.value(2).toUInt();
+            if ((h < na) && (a < na) && (p < na)) {
+                u[(h*na + a)*na + p] = qtQry.value(3).toDouble();
+                nRows++;
             }
-            chji = (vnij < 0) ? (chji - vnij) : chji;
-            if (0 >= chji) {
-              throw KException("SMPModel::getQuadMapPoint: chij must be positive");
+        }
+        if (na*na*na != nRows) {
+          throw KException("SMPModel::getQuadMapGrid: PosUtil is incomplete for this turn");
+        }
+
+        auto s = vector<double>(na, 0.0);
+        query = "SELECT Act_i, SUM(Sal) FROM SpatialSalience" + scenTurn + " GROUP BY Act_i";
+        if (!qtQry.exec(query.c_str())) {
+          throw KException("SMPModel::getQuadMapGrid: could not read SpatialSalience");
+        }
+        while (qtQry.next()) {
+            const unsigned int a = qtQry.value(0).toUInt();
+            if (a < na) {
+                s[a] = qtQry.value(1).toDouble();
             }
         }
-    }
 
-    qtQry.finish();
-    qtQry.clear();
+        auto c = vector<double>(na, 0.0);
+        query = "SELECT Act_i, Cap FROM SpatialCapability" + scenTurn;
+        if (!qtQry.exec(query.c_str())) {
+          throw KException("SMPModel::getQuadMapGrid: could not read SpatialCapability");
+        }
+        while (qtQry.next()) {
+            const unsigned int a = qtQry.value(0).toUInt();
+            if (a < na) {
+                c[a] = qtQry.value(1).toDouble();
+            }
+        }
+        qtQry.finish();
+        qtQry.clear();
 
-    const double phij = chij / (chij + chji); // ProbVict, for i
-    const double phji = chji / (chij + chji);
+        return shared_ptr<const QuadMapGrid>(new QuadMapGrid(na, u, s, c, vrCltn, tpCommit, numPar));
+    };
+    return cachedQuadMapGrid(key, build);
+}
 
-    const double euVict = uhkij;  // UtilVict
-    const double euCntst = phij*uhkij + phji*uhkji; // UtilContest,
-    const double euChlg = (1 - sj)*euVict + sj*euCntst; // UtilChlg
+double SMPModel::getQuadMapPoint(size_t t, size_t est_h, size_t aff_k, size_t init_i, size_t rcvr_j) {
+    return getQuadMapGrid(t)->point(est_h, aff_k, init_i, rcvr_j);
+}
 
-    return (euChlg - euSQ);
+double SMPModel::getQuadMapPoint(const QString &connectionName, const string &scenarioID,
+  size_t turn, size_t est_h, size_t aff_k, size_t init_i, size_t rcvr_j) {
+    return getQuadMapGrid(connectionName, scenarioID, turn)->point(est_h, aff_k, init_i, rcvr_j);
 }
 
 tuple<double, double> SMPModel::calcContribs(VotingRule vrCltn, double wi, double wj, tuple<double, double, double, double>(utils)) {
@@ -2085,6 +2426,7 @@ tuple<double, double> SMPModel::calcContribs(VotingRule vrCltn, double wi, doubl
 
 void SMPModel::destroyModel() {
     delete md0;
+    clearQuadMapCache();
 }
 
 void SMPModel::randomSMP(unsigned int numA, unsigned int sDim, bool accP, uint64_t s, vector<bool> f) {
@@ -26,6 +26,7 @@
 
 #include <string>
 #include <map>
+#include <atomic>
 
 #include <easylogging++.h>
 #include "sqlite3.h"
@@ -96,6 +97,9 @@ ostream& operator<< (ostream& os, const InterVecBrgn& ivb);
 struct BargainSMP {
 public:
   BargainSMP(const SMPActor* ai, const SMPActor* ar, const VctrPstn & pi, const VctrPstn & pr);
+  // with an id reserved in advance by reserveIDs, so that ids do not depend
+  // on the order in which parallel threads create their bargains
+  BargainSMP(const SMPActor* ai, const SMPActor* ar, const VctrPstn & pi, const VctrPstn & pr, uint64_t id);
   ~BargainSMP();
 
 
@@ -104,11 +108,40 @@ public:
   VctrPstn posInit = VctrPstn();
   VctrPstn posRcvr = VctrPstn();
   uint64_t getID() const;
+
+  // reserve n consecutive ids, returning the first
+  static uint64_t reserveIDs(uint64_t n);
 protected:
-  static uint64_t highestBargainID;
+  friend class SMPModel; // to checkpoint highestBargainID
+  static std::atomic<uint64_t> highestBargainID; // atomic, as branches may run in parallel
   uint64_t myBargainID = 0;
 };
 
+// Everything the quad map needs for one turn: each h's estimate of the utilities,
+// and h's estimate of the probability that i defeats j, for every (h,i,j).
+// The third-party coalition loop runs once per (h,i,j) when the grid is built,
+// so any (h,k,i,j) point afterwards costs only a few lookups.
+class QuadMapGrid {
+public:
+  // u[(h*na + a)*na + p] is h's estimate of the utility to a of p's position;
+  // s and c are each actor's total salience and capability
+  QuadMapGrid(unsigned int na, const vector<double> & u, const vector<double> & s,
+              const vector<double> & c, VotingRule vr, ThirdPartyCommit tpc, unsigned int numPar = 0);
+
+  const unsigned int numAct;
+
+  // same as SMPModel::getQuadMapPoint
+  double point(unsigned int h, unsigned int k, unsigned int i, unsigned int j) const;
+
+protected:
+  double util(unsigned int h, unsigned int a, unsigned int p) const {
+    return utils[(h*numAct + a)*numAct + p];
+  }
+  vector<double> utils = {};
+  vector<double> sals = {};
+  vector<double> pVict = {}; // pVict[(h*na + i)*na + j], or NaN if the coalitions were invalid
+};
+
 // -------------------------------------------------
 // Trivial, SMP-like actor with fixed attributes
 // the old smp.cpp file, SpatialState::developTwoPosBargain, for a discussion of
@@ -147,7 +180,8 @@ public:
   // other actors, and not all positions can be represented as a list of doubles.
   static BargainSMP* interpolateBrgn(const SMPActor* ai, const SMPActor* aj,
                                      const VctrPstn* posI, const VctrPstn * posJ,
-                                     double prbI, double prbJ, InterVecBrgn ivb);
+                                     double prbI, double prbJ, InterVecBrgn ivb,
+                                     uint64_t id);
 
 
 protected:
@@ -163,7 +197,7 @@ protected:
 };
 
 class SMPState : public State {
-
+  friend class SMPModel; // to checkpoint the ideals, accomodate, and movers
 public:
   explicit SMPState(Model * m);
   virtual ~SMPState();
@@ -226,6 +260,10 @@ public:
 
   void setPosMoverBargain(unsigned int actor, uint64_t bargainID);
 
+  // returns estimated probability k wins (given likely coaltiions), and expected delta-util of that challenge.
+  // If desired, record in SQLite.
+  tuple<double, double> probEduChlg(unsigned int h, unsigned int k, unsigned int i, unsigned int j, bool sqlP) const;
+
 protected:
 
 private:
@@ -251,11 +289,8 @@ private:
 
   SMPState* doBCN();
 
-  void doBCN(unsigned int i);
-
-  // returns estimated probability k wins (given likely coaltiions), and expected delta-util of that challenge.
-  // If desired, record in SQLite.
-  tuple<double, double> probEduChlg(unsigned int h, unsigned int k, unsigned int i, unsigned int j, bool sqlP) const;
+  // i's status quo bargain followed by its proposals, if any, numbered from firstID
+  vector<BargainSMP*> doBCN(unsigned int i, uint64_t firstID);
 
   // return best j, p[i>j], edu[i->j]
   tuple<int, double, double> bestChallenge(eduChlgsI &eduI) const;
@@ -294,8 +329,6 @@ private:
 
   vector< vector < BargainSMP* > > brgns;
 
-  std::mutex brgnsLock;
-
   KBase::KMatrix w;
 
   SMPState* s2 = nullptr;
@@ -306,7 +339,11 @@ private:
 
   std::mutex mtxLock;
 
-  void updateBestBrgnPositions(int k);
+  // [actor, bargain] utilities of the states resulting from each of brgns[k]
+  KMatrix bargainUtils(unsigned int k) const;
+  // choose k's bargain, given its bargain utilities and their PCE distribution
+  // selP is the uniform draw used by StochasticSTM
+  void updateBestBrgnPositions(int k, const KMatrix & u_im, const KMatrix & p, double selP);
 
   vector<double> calcVotes(KMatrix w, KMatrix u, int actor) const;
 
@@ -347,11 +384,11 @@ private:
   >;
   using BrgnUtils = vector<BrgnUtil>;
   BrgnUtils brgnUtils;
-  std::mutex brgnPosLock;
 };
 
 class SMPModel : public Model {
   friend class SMPState;
+  friend class QuadMapGrid; // to use calcContribs
 public:
   explicit SMPModel( string desc = "", uint64_t s=KBase::dSeed, vector<bool> f={}, string sceName = ""); // JAH 20160711 added rng seed
   virtual ~SMPModel();
@@ -362,8 +399,30 @@ public:
   static double bvDiff(const KMatrix & vd, const  KMatrix & vs);
   static double bvUtil(const KMatrix & vd, const  KMatrix & vs, double R);
 
+  // a non-zero histWindow streams the history to the DB, keeping only that many recent states in memory.
+  // A non-zero ckptEvery always streams the history, with a window of 2 unless histWindow is larger.
   static std::string runModel(std::vector<bool> sqlFlags,
-      std::string inputDataFile, uint64_t seed, bool saveHist, std::vector<int> modelParams = std::vector<int>());
+      std::string inputDataFile, uint64_t seed, bool saveHist, std::vector<int> modelParams = std::vector<int>(),
+      unsigned int histWindow = 0, unsigned int ckptEvery = 0);
+
+  // continue an interrupted run from a checkpoint written by runModel with non-zero ckptEvery.
+  // As the turns before the checkpoint are not restored, the history is always streamed.
+  static std::string resumeModel(std::vector<bool> sqlFlags, std::string ckptFile,
+      unsigned int histWindow = 0, unsigned int ckptEvery = 0);
+
+  // What-if analysis: copy the parent as it was at turn t, apply the mutation
+  // (e.g. change an actor's sCap or vSal), and return a model ready to continue
+  // from turn t under a new scenario ID. The turns before t are not recomputed or
+  // copied, except states 0 and 1 for the stopping rule; their records stay with the parent's scenario.
+  // The parent must still hold turn t, so a streamed parent can only branch inside its window.
+  // The branch continues the parent's PRNG stream from where the parent is now,
+  // so a stochastic parent's own continuation from t is not reproduced.
+  static SMPModel * branch(const SMPModel * parent, unsigned int t,
+      function<void(SMPModel *)> mutate);
+
+  // run each branch to completion, up to numPar at a time, and return their scenario IDs.
+  // SQLite locks its file exclusively, so with SQLite the branches run one at a time.
+  static vector<string> runBranches(const vector<SMPModel *> & branches, unsigned int numPar = 0);
 
   // this sets up a standard configuration and runs it
   static void configExec(SMPModel * md0);
@@ -390,8 +449,14 @@ public:
   // print history of each actor in CSV (might want to generalize to arbitrary VctrPstn)
   void showVPHistory() const;
 
+  // print and record just turn t, as states are flushed from a streamed history
+  void showVPTurn(unsigned int t) const;
+
   void LogInfoTables(); // JAH 20160731
 
+  // SpatialCapability and SpatialSalience records for turn t
+  void sqlCapSal(unsigned int t);
+
   // output the two files needed to draw Sankey diagrams
   void sankeyOutput(string inputCSV) const;
 
@@ -433,6 +498,16 @@ public:
   static double getQuadMapPoint(const QString &connectionName, const string &scenarioID,
     size_t turn, size_t est_h, size_t aff_k, size_t init_i, size_t rcvr_j);
 
+  /**
+  * The full quad map for one turn, built in one pass and cached per scenario and turn.
+  * These are what both versions of getQuadMapPoint use; the first reads the history,
+  * the second reads the DB with one query per table.
+  */
+  static shared_ptr<const QuadMapGrid> getQuadMapGrid(size_t t, unsigned int numPar = 0);
+  static shared_ptr<const QuadMapGrid> getQuadMapGrid(const QString &connectionName,
+    const string &scenarioID, size_t turn, unsigned int numPar = 0);
+  static void clearQuadMapCache();
+
   static uint getIterationCount();
 
   static uint getNumActors();
@@ -450,7 +525,17 @@ protected:
 
   // note that the function to write to table #k must be kept
   // synchronized with the result of createTableSQL(k) !
-  void sqlTest();
+  void sqlTest(const QString & connName = QString("smpDB"));
+
+  // helpers for writing the VectorPosition table
+  bool vpLogging() const;
+  void prepareVPInsert() const;
+  double sqlVPRow(unsigned int t, unsigned int i, unsigned int k) const;
+
+  virtual void saveConfig(ostream & os) const;
+  virtual void loadConfig(std::istream & is);
+  virtual void saveState(ostream & os, const State * s) const;
+  virtual State * loadState(std::istream & is);
 
   // voting rule for actors when forming coalitions over positions or bargains
   VotingRule vrCltn = VotingRule::Proportional;
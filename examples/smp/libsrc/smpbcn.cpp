@@ -26,6 +26,7 @@
 // --------------------------------------------
 
 #include "smp.h"
+#include <algorithm>
 #include <QSqlQuery>
 #include <QVariant>
 #include <QSqlError>
@@ -38,6 +39,10 @@ using std::map;
 
 using KBase::PRNG;
 using KBase::KMatrix;
+using KBase::KLog;
+using KBase::KLogEvent;
+using KBase::KMetrics;
+using KBase::KPhaseTimer;
 using KBase::KException;
 using KBase::Actor;
 using KBase::Model;
@@ -54,7 +59,7 @@ using KBase::ReportingLevel;
 using KBase::nameFromEnum;
 
 // --------------------------------------------
-uint64_t BargainSMP::highestBargainID = 1000;
+std::atomic<uint64_t> BargainSMP::highestBargainID(1000);
 
 // big enough buffer to build all desired SQLite statements
 const unsigned int sqlBuffSize = 250;
@@ -74,7 +79,12 @@ ostream& operator<< (ostream& os, const InterVecBrgn& ivb) {
 
 // --------------------------------------------
 
-BargainSMP::BargainSMP(const SMPActor* ai, const SMPActor* ar, const VctrPstn & pi, const VctrPstn & pr) {
+BargainSMP::BargainSMP(const SMPActor* ai, const SMPActor* ar, const VctrPstn & pi, const VctrPstn & pr) :
+  BargainSMP(ai, ar, pi, pr, BargainSMP::highestBargainID++) {
+}
+
+BargainSMP::BargainSMP(const SMPActor* ai, const SMPActor* ar, const VctrPstn & pi, const VctrPstn & pr,
+                       uint64_t id) {
   if (nullptr == ai) {
     throw KException("BargainSMP::BargainSMP: Initiator actor is null");
   }
@@ -85,7 +95,7 @@ BargainSMP::BargainSMP(const SMPActor* ai, const SMPActor* ar, const VctrPstn &
   actRcvr = ar;
   posInit = pi;
   posRcvr = pr;
-  myBargainID = BargainSMP::highestBargainID++;
+  myBargainID = id;
 }
 
 BargainSMP::~BargainSMP() {
@@ -102,12 +112,17 @@ uint64_t BargainSMP::getID() const {
   return myBargainID;
 }
 
+uint64_t BargainSMP::reserveIDs(uint64_t n) {
+  return BargainSMP::highestBargainID.fetch_add(n);
+}
+
 // --------------------------------------------
 /*
  * Calculate all the utilities and record in database. utitlity for (i,i,i,j)
  * combination is getting calculated and recorded in a separate method
  */
 void SMPState::calcUtils(unsigned int i, unsigned int bestJ ) const { // i == actor id
+  KPhaseTimer tm("calcUtils");
   const unsigned int na = model->numAct;
   const bool recordTmpSQLP = true;  // Record this in SQLite
   auto pFn = [this, recordTmpSQLP](unsigned int h, unsigned int k, unsigned int i, unsigned int j) {
@@ -201,42 +216,72 @@ SMPState* SMPState::doBCN() {
     brgns[i] = vector<BargainSMP*>();
   }
 
-  auto thrBCN = [this](unsigned int i) {
-    this->doBCN(i);
+  // Each actor's bargains go into its own slot, numbered from its own block of ids,
+  // and are filed into brgns afterwards in actor order. Neither their order nor
+  // their ids then depend on the number of threads or on how they were scheduled.
+  const uint64_t idsPerActor = 4; // SQ, IIJ, JIJ, IJ
+  const uint64_t firstID = BargainSMP::reserveIDs(idsPerActor * na);
+  auto actorBrgns = vector<vector<BargainSMP*>>(na);
+  auto thrBCN = [this, &actorBrgns, firstID, idsPerActor](unsigned int i) {
+    actorBrgns[i] = this->doBCN(i, firstID + idsPerActor * i);
   };
 
-  KBase::groupThreads(thrBCN, 0, na - 1);
-
-  model->beginDBTransaction();
-
-  if (model->sqlFlags[2]) {
-    recordProbEduChlg();
+  {
+    KPhaseTimer tm("bargainProposal");
+    KBase::groupThreads(thrBCN, 0, na - 1);
   }
 
-  if (model->sqlFlags[3]) {
-    for (auto brgnCoord : brgnCos) {
-      model->sqlBargainCoords(
-        get<0>(brgnCoord), //turn
-        get<1>(brgnCoord), //bargnId
-        get<2>(brgnCoord), //posInit
-        get<3>(brgnCoord)  //posRcvr
-      );
+  // the same order in which a single thread would have queued them
+  for (unsigned int i = 0; i < na; i++) {
+    brgns[i].push_back(actorBrgns[i][0]); // status quo
+    for (unsigned int m = 1; m < actorBrgns[i].size(); m++) {
+      BargainSMP* b = actorBrgns[i][m];
+      const int j = model->actrNdx(b->actRcvr);
+      brgns[i].push_back(b); // initiator's copy, delete only it later
+      brgns[j].push_back(b); // receiver's copy, just null it out later
     }
   }
+  std::stable_sort(brgnVals.begin(), brgnVals.end(), [](const BrgnValue & a, const BrgnValue & b) {
+    return get<1>(a) < get<1>(b);
+  });
+  std::stable_sort(brgnCos.begin(), brgnCos.end(), [](const BrgnCoord & a, const BrgnCoord & b) {
+    return get<1>(a) < get<1>(b);
+  });
+  KLog::flush(); // keep the bargaining reports ahead of what follows
+
+  {
+    KPhaseTimer tm("sqlLogging");
+    model->beginDBTransaction();
 
-  if (model->sqlFlags[4]) {
-    for (auto brgnVal : brgnVals) {
-      model->sqlBargainEntries(
-        get<0>(brgnVal), //turn
-        get<1>(brgnVal), //bargnId
-        get<2>(brgnVal), //initiator
-        get<3>(brgnVal), //receiver
-        get<4>(brgnVal)  //value
-      );
+    if (model->sqlFlags[2]) {
+      recordProbEduChlg();
+    }
+
+    if (model->sqlFlags[3]) {
+      for (auto brgnCoord : brgnCos) {
+        model->sqlBargainCoords(
+          get<0>(brgnCoord), //turn
+          get<1>(brgnCoord), //bargnId
+          get<2>(brgnCoord), //posInit
+          get<3>(brgnCoord)  //posRcvr
+        );
+      }
+    }
+
+    if (model->sqlFlags[4]) {
+      for (auto brgnVal : brgnVals) {
+        model->sqlBargainEntries(
+          get<0>(brgnVal), //turn
+          get<1>(brgnVal), //bargnId
+          get<2>(brgnVal), //initiator
+          get<3>(brgnVal), //receiver
+          get<4>(brgnVal)  //value
+        );
+      }
     }
-  }
 
-  //model->commitDBTransaction();
+    //model->commitDBTransaction();
+  }
 
   LOG(INFO) << "Bargains to be resolved";
   showBargains(brgns);
@@ -247,42 +292,79 @@ SMPState* SMPState::doBCN() {
 
   s2 = new SMPState(model);
 
-  auto thrCalcPosts = [this](unsigned int k) {
-    this->updateBestBrgnPositions(k);
+  // Bargain utilities for each actor in parallel, then the small PCE
+  // problems of all actors in one batch, then each actor's choice.
+  auto uims = vector<KMatrix>(na);
+  auto thrCalcUtils = [this, &uims](unsigned int k) {
+    uims[k] = this->bargainUtils(k);
   };
+  {
+    KPhaseTimer tm("bargainUtils");
+    KBase::groupThreads(thrCalcUtils, 0, na - 1);
+  }
 
-  KBase::groupThreads(thrCalcPosts, 0, na - 1);
-
-  //model->beginDBTransaction();
+  auto smod = dynamic_cast<SMPModel *>(model);
+  LOG(INFO) << "Doing scalarPCE for the bargains of all" << na << "actors ...";
+  auto pces = vector<KMatrix>();
+  {
+    KPhaseTimer tm("scalarPCE");
+    pces = Model::scalarPCE(vector<KMatrix>(na, w), uims,
+                            smod->vrCltn, smod->vpm, smod->pcem, ReportingLevel::Medium);
+  }
 
+  // StochasticSTM takes its draws serially, in actor order, and each actor's
+  // votes and utilities go into its own slot
+  auto selPs = vector<double>(na, 0.0);
+  if (StateTransMode::StochasticSTM == smod->stm) {
+    for (unsigned int k = 0; k < na; k++) {
+      selPs[k] = model->rng->uniform(0.0, 1.0);
+    }
+  }
   if (model->sqlFlags[3]) {
-    for (auto votes : brgnVotes) {
-      for (auto vote : votes) {
-        model->sqlBargainVote(
-          get<0>(vote), //turn
-          get<1>(vote), //barginIDsPair_i_j
-          get<2>(vote), //pv_ij
-          get<3>(vote)  //actor
+    brgnVotes.resize(na);
+    brgnUtils.resize(na);
+  }
+  auto thrCalcPosts = [this, &uims, &pces, &selPs](unsigned int k) {
+    this->updateBestBrgnPositions(k, uims[k], pces[k], selPs[k]);
+  };
+  {
+    KPhaseTimer tm("bargainSelection");
+    KBase::groupThreads(thrCalcPosts, 0, na - 1);
+  }
+
+  {
+    KPhaseTimer tm("sqlLogging");
+    //model->beginDBTransaction();
+
+    if (model->sqlFlags[3]) {
+      for (auto votes : brgnVotes) {
+        for (auto vote : votes) {
+          model->sqlBargainVote(
+            get<0>(vote), //turn
+            get<1>(vote), //barginIDsPair_i_j
+            get<2>(vote), //pv_ij
+            get<3>(vote)  //actor
+          );
+        }
+      }
+
+      for (auto util : brgnUtils) {
+        model->sqlBargainUtil(
+          get<0>(util), //turn
+          get<1>(util), //bargnIds
+          get<2>(util)  //utilities
         );
       }
     }
 
-    for (auto util : brgnUtils) {
-      model->sqlBargainUtil(
-        get<0>(util), //turn
-        get<1>(util), //bargnIds
-        get<2>(util)  //utilities
-      );
+    // record data so far
+    if (model->sqlFlags[4]) {
+      updateBargnTable(brgns, actorBargains, actorMaxBrgNdx);
     }
-  }
 
-  // record data so far
-  if (model->sqlFlags[4]) {
-    updateBargnTable(brgns, actorBargains, actorMaxBrgNdx);
+    model->commitDBTransaction();
   }
 
-  model->commitDBTransaction();
-
   // Some bargains are nullptr, and there are two copies of every non-nullptr randomly
   // arranged. If we delete them as we find them, then the second occurance will be corrupted,
   // so the code crashes when it tries to access the memory to see if it matches something
@@ -332,17 +414,15 @@ SMPState* SMPState::doBCN() {
   return s2;
 }
 
-void SMPState::doBCN(unsigned int i) {
+vector<BargainSMP*> SMPState::doBCN(unsigned int i, uint64_t firstID) {
     auto ai = ((const SMPActor*)(model->actrs[i]));
     auto posI = ((const VctrPstn*)pstns[i]);
     auto smod = dynamic_cast<SMPModel *>(model);
     const InterVecBrgn ivb = smod->ivBrgn;
     const SMPBargnModel bMod = smod->brgnMod;
 
-    auto sqBrgnI = new BargainSMP(ai, ai, *posI, *posI);
-    brgnsLock.lock();
-    brgns[i].push_back(sqBrgnI);
-    brgnsLock.unlock();
+    auto sqBrgnI = new BargainSMP(ai, ai, *posI, *posI, firstID);
+    auto brgnsI = vector<BargainSMP*>{ sqBrgnI };
 
     // before we can log this bargain, we need to get the group ID for this table
     // so then we can get the flag to populate the table or not
@@ -372,11 +452,15 @@ void SMPState::doBCN(unsigned int i) {
       brgnValsLock.unlock();
     }
 
-    eduChlgsI eduI = bestChallengeUtils(i);
-
-    auto chlgI = bestChallenge(eduI);
+    auto chlgI = tuple<int, double, double>();
+    {
+      KPhaseTimer tm("challengeSearch");
+      eduChlgsI eduI = bestChallengeUtils(i);
+      chlgI = bestChallenge(eduI);
+    }
     const double bestEU = get<2>(chlgI);
     if (0 < bestEU) {
+      KMetrics::count("bargainProposal");
       unsigned int bestJ = get<0>(chlgI); //
       const double piiJ = get<1>(chlgI); // i's estimate of probability i defeats j
       if (0 > bestJ) {
@@ -407,7 +491,7 @@ void SMPState::doBCN(unsigned int i) {
       auto est_jjij = pFn(j, j, i, j); // J's estimate of the effect on J of I->J
 
       // interpolate a bargain from I's perspective
-      BargainSMP* brgnIIJ = SMPActor::interpolateBrgn(ai, aj, posI, posJ, piiJ, 1 - piiJ, ivb);
+      BargainSMP* brgnIIJ = SMPActor::interpolateBrgn(ai, aj, posI, posJ, piiJ, 1 - piiJ, ivb, firstID + 1);
       const int nai = model->actrNdx(brgnIIJ->actInit);
       const int naj = model->actrNdx(brgnIIJ->actRcvr);
       // verify that identities match up as expected
@@ -421,7 +505,7 @@ void SMPState::doBCN(unsigned int i) {
 
       // interpolate a bargain from targeted J's perspective
       double pjiJ = get<1>(Vjij); // j's estimate of the probability that i defeats j
-      BargainSMP* brgnJIJ = SMPActor::interpolateBrgn(ai, aj, posI, posJ, pjiJ, 1 - pjiJ, ivb);
+      BargainSMP* brgnJIJ = SMPActor::interpolateBrgn(ai, aj, posI, posJ, pjiJ, 1 - pjiJ, ivb, firstID + 2);
 
       // calcluate weights as capability times salience
       double sci = brgnIIJ->actInit->sCap;
@@ -434,77 +518,77 @@ void SMPState::doBCN(unsigned int i) {
       // create a new bargain whose positions are the weighted averages
       auto bpi = VctrPstn((wi*brgnIIJ->posInit + wj*brgnJIJ->posInit) / (wi + wj));
       auto bpj = VctrPstn((wi*brgnIIJ->posRcvr + wj*brgnJIJ->posRcvr) / (wi + wj));
-      BargainSMP *brgnIJ = new  BargainSMP(brgnIIJ->actInit, brgnIIJ->actRcvr, bpi, bpj);
-
-      mtxLock.lock();
-      LOG(INFO) << KBase::getFormattedString(
-        "In turn %i actor %u has most advantageous target %u worth %.3f",
-        turn, i, j, bestEU);
-
-      // Look for counter-intuitive cases
-      if (piiJ < 0.5) {
-        LOG(INFO) << "turn" << turn << ","
-            << "i" << i << ","
-            << "j" << j << ","
-            << "bestEU worth" << bestEU << ","
-            << "piiJ " << piiJ;
+      BargainSMP *brgnIJ = new  BargainSMP(brgnIIJ->actInit, brgnIIJ->actRcvr, bpi, bpj, firstID + 3);
+
+      // Formatting is skipped entirely when logging is off. Otherwise the numbers go
+      // out as one structured event, formatted on the log thread, with the bargain
+      // positions appended as text so that the whole report stays together.
+      if (KLog::enabled()) {
+        auto posLine = [](const string & proposal, const KMatrix & pos) {
+          string ln = proposal;
+          const auto p100 = KBase::trans(pos) * 100.0; // print on the scale of [0,100]
+          for (unsigned int d = 0; d < p100.numC(); d++) {
+            ln += KBase::getFormattedString(" %.3f ", p100(0, d));
+          }
+          return ln + "\n";
+        };
+        const string si = std::to_string(i);
+        const string sj = std::to_string(j);
+        KLogEvent ev;
+        ev.turn = turn;
+        ev.n[0] = i;
+        ev.n[1] = j;
+        ev.x[0] = bestEU;
+        ev.x[1] = piiJ;
+        ev.x[2] = get<2>(chlgI);
+        ev.x[3] = get<0>(est_ijij);
+        ev.x[4] = get<1>(est_ijij);
+        ev.x[5] = get<0>(Vjij);
+        ev.x[6] = get<1>(Vjij);
+        ev.x[7] = get<0>(est_jjij);
+        ev.x[8] = get<1>(est_jjij);
+
+        // Bargain positions from i's perspective
+        ev.text = "Bargain " + showOneBargain(brgnIIJ) + " from " + si + "'s perspective (brgnIIJ)\n";
+        ev.text += posLine("   " + si + " proposes " + si + " adopt: ", brgnIIJ->posInit);
+        ev.text += posLine("   " + si + " proposes " + sj + " adopt: ", brgnIIJ->posRcvr);
+        ev.text += "\n";
+
+        // Bargain positions from j's perspective
+        ev.text += "Bargain " + showOneBargain(brgnJIJ) + " from " + sj + "'s perspective (brgnIIJ)\n";
+        ev.text += posLine("   " + sj + " proposes " + si + " adopt: ", brgnJIJ->posInit);
+        ev.text += posLine("   " + sj + " proposes " + sj + " adopt: ", brgnJIJ->posRcvr);
+        ev.text += "\n";
+
+        // Power-weighted compromise
+        ev.text += "Power-weighted compromise " + showOneBargain(brgnIJ) + " bargain (brgnIJ)\n";
+        ev.text += posLine("     compromise proposes " + si + " adopt: ", brgnIJ->posInit);
+        ev.text += posLine("     compromise proposes " + sj + " adopt: ", brgnIJ->posRcvr);
+        ev.text += "\n";
+
+        ev.text += "Using " + KBase::nameFromEnum<SMPBargnModel>(bMod, SMPBargnModelNames) + " to form proposed bargains";
+
+        ev.fmt = [](const KLogEvent & e) {
+          const unsigned int i = e.n[0];
+          const unsigned int j = e.n[1];
+          string s = KBase::getFormattedString(
+            "In turn %i actor %u has most advantageous target %u worth %.3f\n",
+            e.turn, i, j, e.x[0]);
+          // Look for counter-intuitive cases
+          if (e.x[1] < 0.5) {
+            s += KBase::getFormattedString("turn %i , i %u , j %u , bestEU worth %g , piiJ  %g\n",
+                                           e.turn, i, j, e.x[0], e.x[1]);
+          }
+          const char * estFmt = "Est by %2u of prob %.4f that [%2u>%2u], with expected gain to %2u of %+.4f\n";
+          s += KBase::getFormattedString(estFmt, i, e.x[1], i, j, i, e.x[2]); // I's estimate of the effect on I of I->J
+          s += KBase::getFormattedString(estFmt, i, e.x[3], i, j, j, e.x[4]); // I's estimate of the effect on J of I->J
+          s += KBase::getFormattedString(estFmt, j, e.x[5], i, j, i, e.x[6]); // J's estimate of the effect on I of I->J
+          s += KBase::getFormattedString(estFmt, j, e.x[7], i, j, j, e.x[8]); // J's estimate of the effect on J of I->J
+          return s + "\n" + e.text;
+        };
+        KLog::post(std::move(ev));
       }
 
-      // I's estimate of the effect on I of I->J
-      LOG(INFO) << KBase::getFormattedString(
-        "Est by %2u of prob %.4f that [%2u>%2u], with expected gain to %2u of %+.4f",
-        i, piiJ, i, j, i, get<2>(chlgI));
-
-      // I's estimate of the effect on J of I->J
-      LOG(INFO) << KBase::getFormattedString(
-          "Est by %2u of prob %.4f that [%2u>%2u], with expected gain to %2u of %+.4f",
-          i, get<0>(est_ijij), i, j, j, get<1>(est_ijij));
-
-      // J's estimate of the effect on I of I->J
-      LOG(INFO) << KBase::getFormattedString(
-          "Est by %2u of prob %.4f that [%2u>%2u], with expected gain to %2u of %+.4f",
-          j, get<0>(Vjij), i, j, i, get<1>(Vjij));
-
-      // J's estimate of the effect on J of I->J
-      LOG(INFO) << KBase::getFormattedString(
-          "Est by %2u of prob %.4f that [%2u>%2u], with expected gain to %2u of %+.4f",
-          j, get<0>(est_jjij), i, j, j, get<1>(est_jjij));
-      LOG(INFO) << "";
-
-      // Bargain positions from i's perspective
-      LOG(INFO) << "Bargain" << showOneBargain(brgnIIJ)
-        << "from" << std::to_string(i) + "'s perspective (brgnIIJ)";
-      //LOG(INFO) << i << "proposes" << i << "adopt:";
-      string proposal = string("   ") + std::to_string(i) + " proposes " + std::to_string(i) + " adopt: ";
-      (KBase::trans(brgnIIJ->posInit) * 100.0).mPrintf(" %.3f ", proposal); // print on the scale of [0,100]
-      //LOG(INFO) << i << "proposes" << j << "adopt:";
-      proposal = string("   ") + std::to_string(i) + " proposes " + std::to_string(j) + " adopt: ";
-      (KBase::trans(brgnIIJ->posRcvr) * 100.0).mPrintf(" %.3f ", proposal); // print on the scale of [0,100]
-      LOG(INFO) << "";
-
-      // Bargain positions from j's perspective
-      LOG(INFO) << "Bargain" << showOneBargain(brgnJIJ)
-        << "from" << std::to_string(j) + "'s perspective (brgnIIJ)";
-      //LOG(INFO) << j << "proposes" << i << "adopt:";
-      proposal = string("   ") + std::to_string(j) + " proposes " + std::to_string(i) + " adopt: ";
-      (KBase::trans(brgnJIJ->posInit) * 100.0).mPrintf(" %.3f ", proposal); // print on the scale of [0,100]
-      //LOG(INFO) << j << "proposes" << j << "adopt:";
-      proposal = string("   ") + std::to_string(j) + " proposes " + std::to_string(j) + " adopt: ";
-      (KBase::trans(brgnJIJ->posRcvr) * 100.0).mPrintf(" %.3f ", proposal); // print on the scale of [0,100]
-      LOG(INFO) << "";
-
-      // Power-weighted compromise
-      LOG(INFO) << "Power-weighted compromise" << showOneBargain(brgnIJ) << "bargain (brgnIJ)";
-      //LOG(INFO) << "  Compromise proposes" << i << "adopt: ";
-      proposal = string("   ") + string("  compromise proposes ") + std::to_string(i) + " adopt: ";
-      (KBase::trans(brgnIJ->posInit) * 100.0).mPrintf(" %.3f ", proposal); // print on the scale of [0,100]
-
-      //LOG(INFO) << "  Compromise proposes" << j << "adopt: ";
-      proposal = string("   ") + string("  compromise proposes ") + std::to_string(j) + " adopt: ";
-      (KBase::trans(brgnIJ->posRcvr) * 100.0).mPrintf(" %.3f ", proposal); // print on the scale of [0,100]
-      LOG(INFO) << "";
-
-
       // TODO: make one-perspective an option.
       // For now, emulate it by swapping
       //auto tIJ = brgnIJ;
@@ -512,8 +596,6 @@ void SMPState::doBCN(unsigned int i) {
       //brgnIJ = tIIJ;
       //brgnIIJ = tIJ;
 
-      LOG(INFO) << "Using" << bMod << "to form proposed bargains";
-      mtxLock.unlock();
       switch (bMod) {
       case SMPBargnModel::InitOnlyInterpSMPBM:
         // record the only one used into SQLite JAH 20160802 use the flag
@@ -529,11 +611,8 @@ void SMPState::doBCN(unsigned int i) {
           brgnCos.push_back(BrgnCoord(turn, brgnIIJ->getID(), brgnIIJ->posInit, brgnIIJ->posRcvr));
           brgnCosLock.unlock();
         }
-        // record this one onto BOTH the initiator and receiver queues
-        brgnsLock.lock();
-        brgns[i].push_back(brgnIIJ); // initiator's copy, delete only it later
-        brgns[j].push_back(brgnIIJ); // receiver's copy, just null it out later
-        brgnsLock.unlock();
+        // to be recorded onto BOTH the initiator and receiver queues
+        brgnsI.push_back(brgnIIJ);
         // clean up unused
         delete brgnIJ;
         brgnIJ = nullptr;
@@ -558,13 +637,9 @@ void SMPState::doBCN(unsigned int i) {
           brgnCos.push_back(BrgnCoord(turn, brgnJIJ->getID(), brgnJIJ->posInit, brgnJIJ->posRcvr));
           brgnCosLock.unlock();
         }
-        // record these both onto BOTH the initiator and receiver queues
-        brgnsLock.lock();
-        brgns[i].push_back(brgnIIJ); // initiator's copy, delete only it later
-        brgns[i].push_back(brgnJIJ); // initiator's copy, delete only it later
-        brgns[j].push_back(brgnIIJ); // receiver's copy, just null it out later
-        brgns[j].push_back(brgnJIJ); // receiver's copy, just null it out later
-        brgnsLock.unlock();
+        // to be recorded onto BOTH the initiator and receiver queues
+        brgnsI.push_back(brgnIIJ);
+        brgnsI.push_back(brgnJIJ);
         // clean up unused
         delete brgnIJ;
         brgnIJ = nullptr;
@@ -585,11 +660,8 @@ void SMPState::doBCN(unsigned int i) {
           brgnCos.push_back(BrgnCoord(turn, brgnIJ->getID(), brgnIJ->posInit, brgnIJ->posRcvr));
           brgnCosLock.unlock();
         }
-        // record this one onto BOTH the initiator and receiver queues
-        brgnsLock.lock();
-        brgns[i].push_back(brgnIJ); // initiator's copy, delete only it later
-        brgns[j].push_back(brgnIJ); // receiver's copy, just null it out later
-        brgnsLock.unlock();
+        // to be recorded onto BOTH the initiator and receiver queues
+        brgnsI.push_back(brgnIJ);
         // clean up unused
         delete brgnIIJ;
         brgnIIJ = nullptr;
@@ -605,28 +677,13 @@ void SMPState::doBCN(unsigned int i) {
 
       thr.join();
     }
-    else {
-      LOG(INFO) << "In turn" << turn << "Actor" << i << "has no advantageous targets";
+    else if (KLog::enabled()) {
+      KLog::post("In turn " + std::to_string(turn) + " Actor " + std::to_string(i) + " has no advantageous targets");
     }
+    return brgnsI;
 }
 
-void SMPState::updateBestBrgnPositions(int k) {
-  auto ndxMaxProb = [](const KMatrix & cv) {
-    const double pTol = 1E-8;
-    if (fabs(KBase::sum(cv) - 1.0) >= pTol) {
-      throw KException("SMPState::updateBestBrgnPositions: Sum of cv is greater than 1");
-    }
-    if (0 == cv.numR()) {
-      throw KException("SMPState::updateBestBrgnPositions: cv doesn't have records");
-    }
-    if (1 != cv.numC()) {
-      throw KException("SMPState::updateBestBrgnPositions: cv must be a column matrix");
-    }
-    auto ndxIJ = ndxMaxAbs(cv);
-    unsigned int iMax = get<0>(ndxIJ);
-    return iMax;
-  };
-
+KMatrix SMPState::bargainUtils(unsigned int k) const {
   // what is the utility to actor nai of the state resulting after
   // the nbj-th bargain of the k-th actor is implemented?
   auto brgnUtil = [this](unsigned int nk, unsigned int nai, unsigned int nbj) {
@@ -689,18 +746,34 @@ void SMPState::updateBestBrgnPositions(int k) {
     auto buk = [brgnUtil, k](unsigned int nai, unsigned int nbj) {
       return brgnUtil(k, nai, nbj);
     };
+    return KMatrix::map(buk, model->numAct, brgns[k].size());
+}
+
+void SMPState::updateBestBrgnPositions(int k, const KMatrix & u_im, const KMatrix & p, double selP) {
+  auto ndxMaxProb = [](const KMatrix & cv) {
+    const double pTol = 1E-8;
+    if (fabs(KBase::sum(cv) - 1.0) >= pTol) {
+      throw KException("SMPState::updateBestBrgnPositions: Sum of cv is greater than 1");
+    }
+    if (0 == cv.numR()) {
+      throw KException("SMPState::updateBestBrgnPositions: cv doesn't have records");
+    }
+    if (1 != cv.numC()) {
+      throw KException("SMPState::updateBestBrgnPositions: cv must be a column matrix");
+    }
+    auto ndxIJ = ndxMaxAbs(cv);
+    unsigned int iMax = get<0>(ndxIJ);
+    return iMax;
+  };
+
     auto smod = dynamic_cast<SMPModel *>(model);
     unsigned int na = smod->numAct;
     unsigned int nb = brgns[k].size();
 
     mtxLock.lock();
-    auto u_im = KMatrix::map(buk, na, nb);
-
-    LOG(INFO) << "u_im:";
+    LOG(INFO) << "u_im for actor" << k << ":";
     u_im.mPrintf(" %.5f ");
 
-    LOG(INFO) << "Doing scalarPCE for the" << nb << "bargains of actor" << k << "...";
-    auto p = Model::scalarPCE(na, nb, w, u_im, smod->vrCltn, smod->vpm, smod->pcem, ReportingLevel::Medium);
     if (nb != p.numR()) {
       throw KException("SMPState::updateBestBrgnPositions: number of bargains mismatched with scalar PCE row count");
     }
@@ -715,7 +788,7 @@ void SMPState::updateBestBrgnPositions(int k) {
       mMax = ndxMaxProb(p);
       break;
     case StateTransMode::StochasticSTM:
-      mMax = model->rng->probSel(p);
+      mMax = PRNG::probSel(p, selP);
       break;
     default:
       throw KException("SMPState::updateBestBrgnPositions - unrecognized StateTransMode");
@@ -756,10 +829,8 @@ void SMPState::updateBestBrgnPositions(int k) {
 
       votes.push_back(BrgnVote(turn, barginIDsPair_i_j, pv_ij, actor));
     }
-    brgnPosLock.lock();
-    brgnVotes.push_back(votes);
-    brgnUtils.push_back(BrgnUtil(turn, bargnIdsRows, u_im));
-    brgnPosLock.unlock();
+    brgnVotes[k] = votes;
+    brgnUtils[k] = BrgnUtil(turn, bargnIdsRows, u_im);
   }
 
     // TODO: create a fresh position for k, from the selected bargain mMax.
@@ -143,9 +143,9 @@ KTable * SMPModel::createSQL(unsigned int n)  {
 }
 
 
-void SMPModel::sqlTest() {
+void SMPModel::sqlTest(const QString & connName) {
   QCoreApplication::addLibraryPath("./plugins");
-  initDBDriver(QString("smpDB"));
+  initDBDriver(connName);
 
   if (0 == dbDriver.compare("QPSQL")) {
     if (!connectDB()) {
@@ -218,7 +218,8 @@ void SMPModel::sqlTest() {
 // JAH 20160731 added this function in replacement to the separate
 // populate* functions that separately logged information tables
 // this calls the kmodel version for Actors and Scenarios and then handles
-// salience, capability, and dimensions tables
+// the accommodation and dimensions tables; sqlCapSal handles the per-turn
+// salience and capability tables
 void SMPModel::LogInfoTables()
 {
   // first call the KModel version to do the actors and scenarios tables
@@ -235,12 +236,6 @@ void SMPModel::LogInfoTables()
   string sqlD = string("INSERT INTO DimensionDescription (ScenarioId,Dim_k,\"Desc\") VALUES ('")
     + scenId + "', :dim_k, :desc)";
 
-  string sqlC = string("INSERT INTO SpatialCapability (ScenarioId, Turn_t, Act_i, Cap) VALUES ('")
-    + scenId + "', :turn_t, :act_i, :cap)";
-
-  string sqlS = string("INSERT INTO SpatialSalience (ScenarioId, Turn_t, Act_i, Dim_k,Sal) VALUES ('")
-    + scenId + "', :turn_t, :act_i, :dim_k, :sal)";
-
   string sqlSc = string("UPDATE ScenarioDesc SET VotingRule = :vr, BigRAdjust = :br, "
     "BigRRange = :brr, ThirdPartyCommit = :tpc, InterVecBrgn = :ivb, BargnModel = :bm "
     " WHERE ScenarioId = '")
@@ -292,56 +287,6 @@ void SMPModel::LogInfoTables()
     }
   }
 
-  // Spatial Capability
-  query.prepare(QString::fromStdString(sqlC));
-  // for each turn extract the information
-  for (unsigned int t = 0; t < history.size(); t++) {
-    auto st = history[t];
-    // get each actors capability value for each turn
-    auto cp = (const SMPState*)history[t];
-    auto caps = cp->actrCaps();
-    for (unsigned int i = 0; i < numAct; i++) {
-      // bind data
-      query.bindValue(":turn_t", t);
-      query.bindValue(":act_i", i);
-      query.bindValue(":cap", caps(0, i));
-      // record
-      if (!query.exec()) {
-        LOG(INFO) << query.lastError().text().toStdString();
-        throw KException("SMPModel::LogInfoTables: Failed to write SpatialCapability record");
-      }
-    }
-  }
-
-  // Spatial Salience
-  query.prepare(QString::fromStdString(sqlS));
-  // for each turn extract the information
-  for (unsigned int t = 0; t < history.size(); t++) {
-    // Get the individual turn
-    auto st = history[t];
-    // get the SMPState for turn
-    auto cp = (const SMPState*)history[t];
-    // Extract information for each actor and dimension
-    for (unsigned int i = 0; i < numAct; i++) {
-      for (unsigned int k = 0; k < numDim; k++) {
-        // Populate the actor
-        auto ai = ((const SMPActor*)actrs[i]);
-        // Get the Salience Value for each actor
-        //                double sal = ai->vSal(k, 0);
-        //bind the data
-        query.bindValue(":turn_t", t);
-        query.bindValue(":act_i", i);
-        query.bindValue(":dim_k", k);
-        query.bindValue(":sal", ai->vSal(k, 0));
-        // record
-        if (!query.exec()) {
-          LOG(INFO) << query.lastError().text().toStdString();
-          throw KException("SMPModel::LogInfoTables: Failed to write SpatialSalience record");
-        }
-      }
-    }
-  }
-
   query.prepare(QString::fromStdString(sqlSc));
   //ScenarioDesc table
   query.bindValue(":vr", static_cast<int>(vrCltn));
@@ -362,6 +307,66 @@ void SMPModel::LogInfoTables()
   return;
 }
 
+// The per-turn info tables, SpatialCapability and SpatialSalience, are written
+// one turn at a time, so that a streamed history can write each turn as it is
+// flushed, before the state is released.
+void SMPModel::sqlCapSal(unsigned int t)
+{
+  if (t >= history.size()) {
+    throw KException("SMPModel::sqlCapSal: Specified turn number is beyond the size of history");
+  }
+  auto cp = (const SMPState*)history[t];
+  if (nullptr == cp) {
+    throw KException("SMPModel::sqlCapSal: state is a null pointer");
+  }
+
+  string sqlC = string("INSERT INTO SpatialCapability (ScenarioId, Turn_t, Act_i, Cap) VALUES ('")
+    + scenId + "', :turn_t, :act_i, :cap)";
+
+  string sqlS = string("INSERT INTO SpatialSalience (ScenarioId, Turn_t, Act_i, Dim_k,Sal) VALUES ('")
+    + scenId + "', :turn_t, :act_i, :dim_k, :sal)";
+
+  qtDB->transaction();
+
+  // Spatial Capability
+  query.prepare(QString::fromStdString(sqlC));
+  // get each actors capability value for this turn
+  auto caps = cp->actrCaps();
+  for (unsigned int i = 0; i < numAct; i++) {
+    // bind data
+    query.bindValue(":turn_t", t);
+    query.bindValue(":act_i", i);
+    query.bindValue(":cap", caps(0, i));
+    // record
+    if (!query.exec()) {
+      LOG(INFO) << query.lastError().text().toStdString();
+      throw KException("SMPModel::sqlCapSal: Failed to write SpatialCapability record");
+    }
+  }
+
+  // Spatial Salience
+  query.prepare(QString::fromStdString(sqlS));
+  // Extract information for each actor and dimension
+  for (unsigned int i = 0; i < numAct; i++) {
+    auto ai = ((const SMPActor*)actrs[i]);
+    for (unsigned int k = 0; k < numDim; k++) {
+      //bind the data
+      query.bindValue(":turn_t", t);
+      query.bindValue(":act_i", i);
+      query.bindValue(":dim_k", k);
+      query.bindValue(":sal", ai->vSal(k, 0));
+      // record
+      if (!query.exec()) {
+        LOG(INFO) << query.lastError().text().toStdString();
+        throw KException("SMPModel::sqlCapSal: Failed to write SpatialSalience record");
+      }
+    }
+  }
+
+  qtDB->commit();
+  return;
+}
+
 
 // --------------------------------------------
 void SMPState::updateBargnTable(const vector<vector<BargainSMP*>> & brgns,
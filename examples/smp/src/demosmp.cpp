@@ -78,6 +78,11 @@ int main(int ac, char **av) {
   bool xmlP = false;
   bool logMin = false;
   bool saveHist = false;
+  unsigned int histWindow = 0;
+  unsigned int ckptEvery = 0;
+  bool resumeP = false;
+  string ckptFile = "";
+  string metricsFile = "";
   string inputCSV = "";
   string inputDBname = "";
   string inputXML = "";
@@ -94,6 +99,10 @@ int main(int ac, char **av) {
     printf("--logmin         log only scenario information + position histories\n");
     printf("--savehist       export by-dim by-turn position histories (input+'_posLog.csv') and\n");
     printf("                 by-dim actor effective powers (input+'_effPower.csv')\n");
+    printf("--window <n>     keep only the last n (at least 2) states in memory, streaming the rest to the DB\n");
+    printf("--ckpt <n>       save a checkpoint (input+'.ckpt') every n turns\n");
+    printf("--resume <f>     continue an interrupted run from the checkpoint file f\n");
+    printf("--metrics <f>    write per-turn phase timings and counters to f (.csv or .json)\n");
     printf("--seed <n>       set a 64bit seed; default is %020llu; 0 means truly random\n", dSeed);
     printf("--connstr        a semicolon separated string for database server credentials:\n");
     printf("                 \"Driver=<QPSQL|QSQLITE>;Server=<IP>*;[Port=<port>]*;Database=<DB_name>;\n");
@@ -147,6 +156,31 @@ int main(int ac, char **av) {
       else if (strcmp(av[i], "--savehist") == 0) {
         saveHist = true;
       }
+      else if (strcmp(av[i], "--window") == 0) {
+        i++;
+        histWindow = std::stoul(av[i]);
+      }
+      else if (strcmp(av[i], "--ckpt") == 0) {
+        i++;
+        ckptEvery = std::stoul(av[i]);
+      }
+      else if (strcmp(av[i], "--resume") == 0) {
+        resumeP = true;
+        i++;
+        if (av[i] != NULL)
+        {
+                ckptFile = av[i];
+        }
+        else
+        {
+                run = false;
+                break;
+        }
+      }
+      else if (strcmp(av[i], "--metrics") == 0) {
+        i++;
+        metricsFile = av[i];
+      }
       else if(strcmp(av[i], "--connstr") == 0) {
         i++;
         connstr = av[i];
@@ -207,6 +241,11 @@ int main(int ac, char **av) {
     return -1;
   }
 
+  if (!metricsFile.empty()) {
+    KBase::KMetrics::reset();
+    KBase::KMetrics::setEnabled(true);
+  }
+
   // note that we reset the seed every time, so that in case something
   // goes wrong, we need not scroll back too far to find the
   // seed required to reproduce the bug.
@@ -219,20 +258,38 @@ int main(int ac, char **av) {
     }
   }
   if (csvP) {
-    string scenid = SMPLib::SMPModel::runModel(sqlFlags, inputCSV, seed, saveHist);
+    string scenid = SMPLib::SMPModel::runModel(sqlFlags, inputCSV, seed, saveHist,
+      std::vector<int>(), histWindow, ckptEvery);
     if (scenid.empty()) {
       LOG(INFO) << "Error: " << KBase::Model::getLastError();
     }
     SMPLib::SMPModel::destroyModel();
   }
   if (xmlP) {
-    string scenid = SMPLib::SMPModel::runModel(sqlFlags, inputXML, seed, saveHist);
+    string scenid = SMPLib::SMPModel::runModel(sqlFlags, inputXML, seed, saveHist,
+      std::vector<int>(), histWindow, ckptEvery);
+    if (scenid.empty()) {
+      LOG(INFO) << "Error: " << KBase::Model::getLastError();
+    }
+    SMPLib::SMPModel::destroyModel();
+  }
+  if (resumeP) {
+    string scenid = SMPLib::SMPModel::resumeModel(sqlFlags, ckptFile, histWindow, ckptEvery);
     if (scenid.empty()) {
       LOG(INFO) << "Error: " << KBase::Model::getLastError();
     }
     SMPLib::SMPModel::destroyModel();
   }
 
+  if (!metricsFile.empty()) {
+    try {
+      KBase::KMetrics::write(metricsFile);
+    }
+    catch (KBase::KException &ke) {
+      LOG(INFO) << "Error writing metrics:" << ke.msg;
+    }
+  }
+
   KBase::displayProgramEnd(sTime);
   return 0;
 }
@@ -0,0 +1,410 @@
+﻿// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------
+// The MIT License (MIT)
+//
+// Copyright (c) 2015 King Abdullah Petroleum Studies and Research Center
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+// and associated documentation files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom
+// the Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or
+// substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+// BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+// DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+// --------------------------------------------
+//
+// Benchmarks for the KTAB kernels and for complete SMP runs.
+// Build with -DENABLE_BENCHMARKS=true; needs Google Benchmark.
+//
+// Typical use:
+//   ./smpbench --benchmark_filter=Coalitions
+//   ./smpbench --benchmark_out=base.json --benchmark_out_format=json
+//   ./smpbench --connstr "Driver=QSQLITE;Database=bench"
+//
+// Benchmarks whose last argument is "threads" cap groupThreads
+// at that many concurrent threads (0 = its usual hardware guess),
+// so the same run reports scaling by thread count.
+// --------------------------------------------
+
+#include <cstring>
+#include <thread>
+#include <benchmark/benchmark.h>
+#include <easylogging++.h>
+
+#include "smp.h"
+#include "gaopt.h"
+
+using std::get;
+using std::string;
+using std::tuple;
+using std::vector;
+using KBase::KMatrix;
+using KBase::Model;
+using KBase::PCEModel;
+using KBase::PRNG;
+using KBase::ReportingLevel;
+using KBase::VPModel;
+using KBase::VctrPstn;
+using KBase::VotingRule;
+using SMPLib::SMPActor;
+using SMPLib::SMPModel;
+using SMPLib::SMPState;
+
+namespace SMPBench {
+
+const uint64_t benchSeed = 0xD67CC16FE762BA6FULL;
+const vector<bool> noSQL = { false, false, false, false, false };
+
+string connStr = "Driver=QSQLITE;Database=smpbench";
+bool dbReady = false;
+
+// thread counts to try: 1, 2, 4, ... up to the hardware, plus 0 for the default guess
+vector<int> threadCounts() {
+  const int hwc = std::max(1u, std::thread::hardware_concurrency());
+  auto tc = vector<int>();
+  for (int t = 1; t < hwc; t = 2 * t) {
+    tc.push_back(t);
+  }
+  tc.push_back(hwc);
+  tc.push_back(0);
+  return tc;
+}
+
+// restores the groupThreads default when a benchmark finishes
+class ThreadCap {
+public:
+  explicit ThreadCap(unsigned int n) { KBase::setMaxThreads(n); }
+  ~ThreadCap() { KBase::setMaxThreads(0); }
+};
+
+// random capabilities and actor-vs-option utilities, on the usual [0,1] scales
+tuple<KMatrix, KMatrix> randomWU(PRNG* rng, unsigned int numAct, unsigned int numOpt) {
+  auto w = KMatrix::uniform(rng, 1, numAct, 1.0, 10.0);
+  auto u = KMatrix::uniform(rng, numAct, numOpt, 0.0, 1.0);
+  return tuple<KMatrix, KMatrix>(w, u);
+}
+
+// a state with randomized actors and positions, with utilities set up
+// exactly as SMPModel::randomSMP does before it runs the model.
+SMPState* randomState(SMPModel* md, unsigned int numA, unsigned int numD) {
+  for (unsigned int d = 0; d < numD; d++) {
+    md->addDim(KBase::getFormattedString("SDim-%02u", d));
+  }
+  auto st = new SMPState(md);
+  md->addState(st);
+  for (unsigned int i = 0; i < numA; i++) {
+    auto ai = new SMPActor(KBase::getFormattedString("SActor-%03u", i), "Random spatial actor");
+    ai->randomize(md->rng, numD);
+    md->addActor(ai);
+    st->pushPstn(new VctrPstn(KMatrix::uniform(md->rng, numD, 1, 0.0, 1.0)));
+  }
+  st->setAccomodate(KBase::iMat(numA));
+  st->idealsFromPstns();
+  st->setUENdx();
+  st->setAUtil(-1, ReportingLevel::Silent);
+  st->setNRA();
+  return st;
+}
+
+// -------------------------------------------------
+// KMatrix
+
+void KMatrixMult(benchmark::State& state) {
+  const unsigned int n = state.range(0);
+  PRNG rng(benchSeed);
+  const auto a = KMatrix::uniform(&rng, n, n, -1.0, +1.0);
+  const auto b = KMatrix::uniform(&rng, n, n, -1.0, +1.0);
+  for (auto _ : state) {
+    auto c = a * b;
+    benchmark::DoNotOptimize(c(0, 0));
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(n) * n * n);
+}
+BENCHMARK(KMatrixMult)->RangeMultiplier(2)->Range(16, 256);
+
+void KMatrixInv(benchmark::State& state) {
+  const unsigned int n = state.range(0);
+  PRNG rng(benchSeed);
+  // diagonally dominant, so safely invertible
+  const auto a = KMatrix::uniform(&rng, n, n, -1.0, +1.0) + (2.0 * n) * KBase::iMat(n);
+  for (auto _ : state) {
+    auto b = KBase::inv(a);
+    benchmark::DoNotOptimize(b(0, 0));
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(n) * n * n);
+}
+BENCHMARK(KMatrixInv)->RangeMultiplier(2)->Range(8, 128);
+
+void KMatrixMap(benchmark::State& state) {
+  const unsigned int n = state.range(0);
+  PRNG rng(benchSeed);
+  const auto a = KMatrix::uniform(&rng, n, n, 0.0, 1.0);
+  auto f = [&a](unsigned int i, unsigned int j) {
+    return a(i, j) * a(j, i);
+  };
+  for (auto _ : state) {
+    auto b = KMatrix::map(f, n, n);
+    benchmark::DoNotOptimize(b(0, 0));
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(n) * n);
+}
+BENCHMARK(KMatrixMap)->RangeMultiplier(4)->Range(16, 1024);
+
+// -------------------------------------------------
+// coalitions and probabilistic Condorcet elections
+
+void Coalitions(benchmark::State& state) {
+  const auto vr = VotingRule(state.range(0));
+  const unsigned int n = state.range(1);
+  PRNG rng(benchSeed);
+  const auto wu = randomWU(&rng, n, n);
+  for (auto _ : state) {
+    auto c = Model::coalitions(vr, get<0>(wu), get<1>(wu));
+    benchmark::DoNotOptimize(c(0, 0));
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(n) * n * n);
+  state.SetLabel(KBase::VotingRuleNames[state.range(0)]);
+}
+BENCHMARK(Coalitions)
+->ArgNames({ "vr", "opts" })
+->Args({ int(VotingRule::Binary), 10 })
+->Args({ int(VotingRule::Binary), 50 })
+->Args({ int(VotingRule::Binary), 100 })
+->Args({ int(VotingRule::Binary), 250 })
+->Args({ int(VotingRule::Proportional), 50 })
+->Args({ int(VotingRule::Proportional), 250 })
+->Args({ int(VotingRule::Cubic), 50 })
+->Args({ int(VotingRule::Cubic), 250 });
+
+void ProbCE2(benchmark::State& state) {
+  const auto pcem = PCEModel(state.range(0));
+  const unsigned int n = state.range(1);
+  const auto vpm = VPModel::Linear;
+  PRNG rng(benchSeed);
+  const auto wu = randomWU(&rng, n, n);
+  const auto c = Model::coalitions(VotingRule::Proportional, get<0>(wu), get<1>(wu));
+  for (auto _ : state) {
+    auto pv = Model::probCE2(pcem, vpm, c);
+    benchmark::DoNotOptimize(get<0>(pv)(0, 0));
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(n));
+  state.SetLabel(KBase::PCEModelNames[state.range(0)]);
+}
+BENCHMARK(ProbCE2)
+->ArgNames({ "pcem", "opts" })
+->Args({ int(PCEModel::ConditionalPCM), 10 })
+->Args({ int(PCEModel::ConditionalPCM), 50 })
+->Args({ int(PCEModel::ConditionalPCM), 250 })
+->Args({ int(PCEModel::MarkovIPCM), 10 })
+->Args({ int(PCEModel::MarkovIPCM), 50 })
+->Args({ int(PCEModel::MarkovIPCM), 250 })
+->Args({ int(PCEModel::MarkovUPCM), 10 })
+->Args({ int(PCEModel::MarkovUPCM), 50 })
+->Args({ int(PCEModel::MarkovUPCM), 250 });
+
+// -------------------------------------------------
+// threading
+
+// each task is a small matrix product, about what one actor's
+// utility or challenge calculation costs in a mid-sized model.
+void GroupThreads(benchmark::State& state) {
+  const unsigned int numTasks = state.range(0);
+  ThreadCap cap(state.range(1));
+  PRNG rng(benchSeed);
+  const auto a = KMatrix::uniform(&rng, 32, 32, -1.0, +1.0);
+  auto out = vector<double>(numTasks, 0.0);
+  auto task = [&a, &out](unsigned int t) {
+    out[t] = (a * a)(t % 32, 0);
+    return;
+  };
+  for (auto _ : state) {
+    KBase::groupThreads(task, 0, numTasks - 1);
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(numTasks));
+}
+BENCHMARK(GroupThreads)
+->ArgNames({ "tasks", "threads" })
+->Apply([](benchmark::internal::Benchmark* b) {
+  for (int tasks : { 64, 1024 }) {
+    for (int t : threadCounts()) {
+      b->Args({ tasks, t });
+    }
+  }
+})
+->UseRealTime();
+
+// -------------------------------------------------
+// genetic algorithm
+
+// real vector on [0,1]^n, scored by a many-peaked function
+class BenchGene {
+public:
+  explicit BenchGene(const KMatrix & v) : x(v) {}
+  KMatrix x;
+
+  double eval() const {
+    double s = 0.0;
+    for (auto xi : x) {
+      s += (1.0 - KBase::sqr(xi - 0.5)) * (1.0 + 0.25 * cos(40.0 * xi));
+    }
+    return s;
+  }
+};
+
+void GAOptGenerations(benchmark::State& state) {
+  const unsigned int popSize = state.range(0);
+  const unsigned int numGen = state.range(1);
+  const unsigned int numGenes = 16;
+  PRNG rng(benchSeed);
+
+  KBase::GAOpt<BenchGene> gOpt(popSize);
+  gOpt.makeGene = [numGenes](PRNG* r) {
+    return new BenchGene(KMatrix::uniform(r, numGenes, 1, 0.0, 1.0));
+  };
+  gOpt.eval = [](const BenchGene* g) {
+    return g->eval();
+  };
+  gOpt.showGene = [](const BenchGene*) {
+    return;
+  };
+  gOpt.equiv = [](const BenchGene* g1, const BenchGene* g2) {
+    return (KBase::norm(g1->x - g2->x) < 1e-12);
+  };
+  gOpt.mutate = [numGenes](const BenchGene* g, PRNG* r) {
+    auto m = new BenchGene(g->x);
+    const unsigned int k = r->uniform() % numGenes;
+    m->x(k, 0) = KBase::trim(m->x(k, 0) + r->uniform(-0.1, 0.1), 0.0, 1.0);
+    return m;
+  };
+  gOpt.cross = [numGenes](const BenchGene* g1, const BenchGene* g2, PRNG* r) {
+    auto c1 = new BenchGene(g1->x);
+    auto c2 = new BenchGene(g2->x);
+    const unsigned int k = r->uniform() % numGenes;
+    for (unsigned int i = k; i < numGenes; i++) {
+      c1->x(i, 0) = g2->x(i, 0);
+      c2->x(i, 0) = g1->x(i, 0);
+    }
+    return tuple<BenchGene*, BenchGene*>(c1, c2);
+  };
+  gOpt.fill(&rng);
+
+  unsigned int iter = 0;
+  unsigned int sIter = 0;
+  for (auto _ : state) {
+    // a tiny stability threshold, so it runs all the generations
+    gOpt.run(&rng, 1.0, 1.0, numGen, 1e-300, numGen - 1, ReportingLevel::Silent, iter, sIter);
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(iter));
+  state.counters["generations"] = iter;
+}
+BENCHMARK(GAOptGenerations)
+->ArgNames({ "pop", "gens" })
+->Args({ 50, 10 })
+->Args({ 200, 10 })
+->Args({ 500, 10 })
+->Unit(benchmark::kMillisecond);
+
+// -------------------------------------------------
+// SMP
+
+// every distinct (i,j) challenge, as seen by i and evaluated for k = i
+void ProbEduChlg(benchmark::State& state) {
+  const unsigned int numA = state.range(0);
+  const unsigned int numD = state.range(1);
+  auto md = new SMPModel("", benchSeed, noSQL);
+  auto st = randomState(md, numA, numD);
+  for (auto _ : state) {
+    double s = 0.0;
+    for (unsigned int i = 0; i < numA; i++) {
+      for (unsigned int j = 0; j < numA; j++) {
+        if (i != j) {
+          s += get<1>(st->probEduChlg(i, i, i, j, false));
+        }
+      }
+    }
+    benchmark::DoNotOptimize(s);
+  }
+  state.SetItemsProcessed(state.iterations() * int64_t(numA) * (numA - 1));
+  delete md;
+}
+BENCHMARK(ProbEduChlg)
+->ArgNames({ "actors", "dims" })
+->Args({ 10, 1 })
+->Args({ 50, 1 })
+->Args({ 50, 3 })
+->Args({ 100, 3 })
+->Args({ 250, 3 });
+
+// complete runs, to convergence, of the same random scenarios as "smpc --euSMP".
+// These are slow, so each configuration runs once.
+void RandomSMP(benchmark::State& state) {
+  if (!dbReady) {
+    state.SkipWithError(Model::getLastError().c_str());
+    return;
+  }
+  const unsigned int numA = state.range(0);
+  const unsigned int numD = state.range(1);
+  ThreadCap cap(state.range(2));
+  for (auto _ : state) {
+    SMPModel::randomSMP(numA, numD, false, benchSeed, noSQL);
+  }
+  state.counters["actors"] = numA;
+}
+BENCHMARK(RandomSMP)
+->ArgNames({ "actors", "dims", "threads" })
+->Apply([](benchmark::internal::Benchmark* b) {
+  const int hwc = std::max(1u, std::thread::hardware_concurrency());
+  for (int na : { 10, 25, 50, 100, 250 }) {
+    for (int nd : { 1, 3 }) {
+      b->Args({ na, nd, 1 });
+      if (1 < hwc) {
+        b->Args({ na, nd, hwc });
+      }
+    }
+  }
+})
+->Iterations(1)
+->UseRealTime()
+->Unit(benchmark::kSecond);
+
+}; // end of namespace
+
+// -------------------------------------------------
+
+int main(int ac, char **av) {
+  benchmark::Initialize(&ac, av);
+  for (int i = 1; i < ac; i++) {
+    if ((strcmp(av[i], "--connstr") == 0) && (i + 1 < ac)) {
+      i++;
+      SMPBench::connStr = av[i];
+    }
+    else {
+      printf("Unrecognized argument %s\n", av[i]);
+      printf("Use Google Benchmark's --benchmark_* options, plus\n");
+      printf("--connstr <s>    database credentials for the complete SMP runs (see smpc --help)\n");
+      return 1;
+    }
+  }
+
+  // the models are very chatty, which would swamp the timings
+  el::Loggers::reconfigureAllLoggers(el::ConfigurationType::Enabled, "false");
+  KBase::KLog::refresh();
+
+  SMPBench::dbReady = SMPModel::loginCredentials(SMPBench::connStr);
+
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
+
+// --------------------------------------------
+// Copyright KAPSARC. Open source MIT License.
+// --------------------------------------------